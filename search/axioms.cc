@@ -24,7 +24,9 @@
 #include "operator.h"
 #include "state.h"
 
-#include <deque>
+#include <algorithm>
+#include <cassert>
+#include <climits>
 #include <iostream>
 using namespace std;
 
@@ -66,18 +68,70 @@ AxiomEvaluator::AxiomEvaluator() {
 	    NegationByFailureInfo nbf_info(var_no, nbf_literal);
 	    nbf_info_by_layer[layer].push_back(nbf_info);
 	}
+	if(layer != -1)
+	    derived_vars.push_back(var_no);
     }
+
+    // Dependencies for incremental evaluation
+    var_dependents.resize(g_variable_domain.size());
+    rules_by_effect_var.resize(g_variable_domain.size());
+    for(int i = 0; i < g_axioms.size(); i++) {
+	int eff_var = rules[i].effect_var;
+	rules_by_effect_var[eff_var].push_back(i);
+	const vector<Prevail> &conditions = g_axioms[i].get_pre_post()[0].cond;
+	for(int j = 0; j < conditions.size(); j++) {
+	    vector<int> &dependents = var_dependents[conditions[j].var];
+	    if(find(dependents.begin(), dependents.end(), eff_var) == dependents.end())
+		dependents.push_back(eff_var);
+	}
+    }
+    affected_epoch.assign(g_variable_domain.size(), -1);
+    epoch = 0;
+
+    int num_literals = 0;
+    for(int i = 0; i < g_variable_domain.size(); i++)
+	num_literals += axiom_literals[i].size();
+    queue.resize(max(num_literals, 1));
+    queue_head = queue_size = 0;
+}
+
+void AxiomEvaluator::push(AxiomLiteral *literal) {
+    if(queue_size == queue.size()) {
+	// Full: unwrap into a buffer of twice the size
+	vector<AxiomLiteral *> larger(2 * queue.size());
+	for(int i = 0; i < queue_size; i++)
+	    larger[i] = queue[(queue_head + i) % queue.size()];
+	queue.swap(larger);
+	queue_head = 0;
+    }
+    queue[(queue_head + queue_size) % queue.size()] = literal;
+    queue_size++;
+}
+
+AxiomEvaluator::AxiomLiteral *AxiomEvaluator::pop() {
+    assert(queue_size > 0);
+    AxiomLiteral *literal = queue[queue_head];
+    queue_head = (queue_head + 1) % queue.size();
+    queue_size--;
+    return literal;
 }
 
 void AxiomEvaluator::evaluate(State &state) {
     // cout << "Evaluating axioms..." << endl;
-    deque<AxiomLiteral *> queue;
+    if(rules.empty()) {
+	// Derived variables without rules keep their default values
+	for(int i = 0; i < derived_vars.size(); i++)
+	    state[derived_vars[i]] = g_default_axiom_values[derived_vars[i]];
+	return;
+    }
+
+    queue_head = queue_size = 0;
     for(int i = 0; i < g_axiom_layers.size(); i++) {
 	if(g_axiom_layers[i] != -1)
 	    state[i] = g_default_axiom_values[i];
-	else {
+	else if(state[i] >= 0) {
 	    // cout << "Enqueuing " << &axiom_literals[i][state[i]] << endl;
-	    queue.push_back(&axiom_literals[i][state[i]]);
+	    push(&axiom_literals[i][state[i]]);
 	}
     }
 
@@ -102,16 +156,83 @@ void AxiomEvaluator::evaluate(State &state) {
 	    if(state[var_no] != val) {
 		// cout << "  -> deduced " << var_no << " = " << val << endl;
 		state[var_no] = val;
-		queue.push_back(rules[i].effect_literal);
+		push(rules[i].effect_literal);
 	    }
 	}
     }
 
+    propagate(state, false);
+}
+
+void AxiomEvaluator::evaluate(State &state, const State &predecessor) {
+    // Starts from the derived values of the predecessor, which is the
+    // state that state was generated from.
+    if(rules.empty())
+	return;
+
+    if(++epoch == INT_MAX) {
+	affected_epoch.assign(affected_epoch.size(), -1);
+	epoch = 0;
+    }
+    affected_vars.clear();
+    for(int var = 0; var < g_axiom_layers.size(); var++) {
+	if(state[var] == predecessor[var])
+	    continue;
+	if(g_axiom_layers[var] != -1) {
+	    // Derived variables are not changed by operators
+	    evaluate(state);
+	    return;
+	}
+	for(int i = 0; i < var_dependents[var].size(); i++) {
+	    int derived = var_dependents[var][i];
+	    if(!is_affected(derived)) {
+		affected_epoch[derived] = epoch;
+		affected_vars.push_back(derived);
+	    }
+	}
+    }
+    for(int i = 0; i < affected_vars.size(); i++) {
+	int var = affected_vars[i];
+	for(int j = 0; j < var_dependents[var].size(); j++) {
+	    int derived = var_dependents[var][j];
+	    if(!is_affected(derived)) {
+		affected_epoch[derived] = epoch;
+		affected_vars.push_back(derived);
+	    }
+	}
+    }
+    if(affected_vars.empty())
+	return;
+
+    queue_head = queue_size = 0;
+    for(int i = 0; i < affected_vars.size(); i++)
+	state[affected_vars[i]] = g_default_axiom_values[affected_vars[i]];
+    // Conditions on unaffected variables are decided by the state, those on
+    // affected variables are counted down when their literals are derived.
+    for(int i = 0; i < affected_vars.size(); i++) {
+	const vector<int> &var_rules = rules_by_effect_var[affected_vars[i]];
+	for(int j = 0; j < var_rules.size(); j++) {
+	    AxiomRule &rule = rules[var_rules[j]];
+	    const vector<Prevail> &conditions = g_axioms[var_rules[j]].get_pre_post()[0].cond;
+	    rule.unsatisfied_conditions = 0;
+	    for(int k = 0; k < conditions.size(); k++)
+		if(is_affected(conditions[k].var) || state[conditions[k].var] != conditions[k].prev)
+		    rule.unsatisfied_conditions++;
+	    if(rule.unsatisfied_conditions == 0 && state[rule.effect_var] != rule.effect_val) {
+		state[rule.effect_var] = rule.effect_val;
+		push(rule.effect_literal);
+	    }
+	}
+    }
+
+    propagate(state, true);
+}
+
+void AxiomEvaluator::propagate(State &state, bool only_affected) {
     for(int layer_no = 0; layer_no < nbf_info_by_layer.size(); layer_no++) {
 	// Apply Horn rules.
-	while(!queue.empty()) {
-	    AxiomLiteral *curr_literal = queue.front();
-	    queue.pop_front();
+	while(queue_size > 0) {
+	    AxiomLiteral *curr_literal = pop();
 	    for(int i = 0; i < curr_literal->condition_of.size(); i++) {
 		AxiomRule *rule = curr_literal->condition_of[i];
 		if(--(rule->unsatisfied_conditions) == 0) {
@@ -120,7 +241,7 @@ void AxiomEvaluator::evaluate(State &state) {
 		    if(state[var_no] != val) {
 			// cout << "  -> deduced " << var_no << " = " << val << endl;
 			state[var_no] = val;
-			queue.push_back(rule->effect_literal);
+			push(rule->effect_literal);
 		    }
 		}
 	    }
@@ -130,8 +251,10 @@ void AxiomEvaluator::evaluate(State &state) {
 	const vector<NegationByFailureInfo> &nbf_info = nbf_info_by_layer[layer_no];
 	for(int i = 0; i < nbf_info.size(); i++) {
 	    int var_no = nbf_info[i].var_no;
+	    if(only_affected && !is_affected(var_no))
+		continue;
 	    if(state[var_no] == g_default_axiom_values[var_no])
-		queue.push_back(nbf_info[i].literal);
+		push(nbf_info[i].literal);
 	}
     }
 }
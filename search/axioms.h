@@ -52,9 +52,30 @@ class AxiomEvaluator {
     std::vector<std::vector<AxiomLiteral> > axiom_literals;
     std::vector<AxiomRule> rules;
     std::vector<std::vector<NegationByFailureInfo> > nbf_info_by_layer;
+    std::vector<int> derived_vars;
+
+    // Literals to propagate, in a ring buffer that only grows if needed
+    std::vector<AxiomLiteral *> queue;
+    int queue_head;
+    int queue_size;
+    void push(AxiomLiteral *literal);
+    AxiomLiteral *pop();
+
+    /* Incremental evaluation: the derived variables that (transitively)
+       depend on a changed variable are affected, the others keep the
+       values of the predecessor. Only rules deriving affected variables
+       are reset and propagated. */
+    std::vector<std::vector<int> > var_dependents; // derived vars with a rule conditioned on var
+    std::vector<std::vector<int> > rules_by_effect_var;
+    std::vector<int> affected_epoch;
+    int epoch;
+    std::vector<int> affected_vars;
+    bool is_affected(int var) const {return affected_epoch[var] == epoch;}
+    void propagate(State &state, bool only_affected);
 public:
     AxiomEvaluator();
     void evaluate(State &state);
+    void evaluate(State &state, const State &predecessor);
 };
 
 #endif
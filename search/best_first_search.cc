@@ -227,13 +227,6 @@ void BestFirstSearchEngine::reward_progress() {
 void BestFirstSearchEngine::generate_successors(const State *parent_ptr) {
     vector<const Operator *> all_operators;
     g_successor_generator->generate_applicable_ops(current_state, all_operators);
-    check_functional_validity(current_state, all_operators);
-    if(is_temporal){
-		check_var_locks_validity(current_state, all_operators);
-		check_temporal_soundness_validity(current_state, all_operators);
-		check_temporal_goals_validity(current_state, all_operators);
-    }
-    check_external_locks_validity(current_state, all_operators);
 
     vector<const Operator *> preferred_operators;
     for(int i = 0; i < preferred_operator_heuristics.size(); i++) {
@@ -241,33 +234,10 @@ void BestFirstSearchEngine::generate_successors(const State *parent_ptr) {
 	if(!heur->is_dead_end())
 	    heur->get_preferred_operators(preferred_operators);
     }
-    check_functional_validity(current_state, preferred_operators);
-    if(is_temporal){
-		check_var_locks_validity(current_state, preferred_operators);
-		check_temporal_soundness_validity(current_state, preferred_operators);
-    }
-    check_external_locks_validity(current_state, preferred_operators);
-
-    if(parent_ptr->running_actions.size() > 1)
-    {
-    	vector<const Operator *>::iterator it = all_operators.begin();
-    	for(; it != all_operators.end();) {
 
-    		if((*it)->get_name().find("_start") == string::npos) {
-    			it = all_operators.erase(it);
-    		}else
-    			it++;
-    	}
-
-    	it = preferred_operators.begin();
-		for(; it != preferred_operators.end();) {
-
-			if((*it)->get_name().find("_start") == string::npos) {
-				it = preferred_operators.erase(it);
-			}else
-				it++;
-		}
-    }
+    // With several actions running, only new start snaps are expanded
+    filter_valid_operators(current_state, all_operators, preferred_operators,
+			   parent_ptr->running_actions.size() > 1);
 
     for(int i = 0; i < open_lists.size(); i++) {
 	Heuristic *heur = open_lists[i].heuristic;
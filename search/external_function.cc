@@ -2,24 +2,45 @@
 
 // #include "utils/system.h"
 
+#include <cstdlib>
 #include <dlfcn.h>
 #include <iostream>
+#include <unordered_set>
 
 using namespace std;
 
 
 ExternalFunctionManager::~ExternalFunctionManager() {
+    stop_workers();
     for (void *handle : open_handles) {
         dlclose(handle);
     }
 }
 
 void ExternalFunctionManager::clear() {
-    functions.clear();
+    stop_workers();
+    pending.clear();
+    pending_index.clear();
+    function_table.clear();
+    function_index.clear();
+    interned_objects.clear();
+    interned_object_ids.clear();
+    state_cache.clear();
+    state_cache_index.clear();
     open_handles.clear();
 }
 
 
+int ExternalFunctionManager::intern_object(const std::string &name) {
+    unordered_map<string, int>::const_iterator it = interned_object_ids.find(name);
+    if (it != interned_object_ids.end())
+        return it->second;
+    int id = interned_objects.size();
+    interned_objects.push_back(name);
+    interned_object_ids[name] = id;
+    return id;
+}
+
 void ExternalFunctionManager::load_module(const ExternalFunctionModuleInfo &module_info) {
     //std::string path = getenv("EF_PATH") + std::string("/");
     //std::string module_folder = (path==""?"./external_functions/":path);
@@ -49,37 +70,312 @@ void ExternalFunctionManager::load_module(const ExternalFunctionModuleInfo &modu
         setup_function();
     }
 
+    // Optional null-terminated list of the functions of the module that are pure
+    const char **pure_functions = (const char **) dlsym(handle, "pure_functions");
+    dlerror();
+    unordered_set<string> pure_names;
+    for (int i = 0; pure_functions != NULL && pure_functions[i] != NULL; i++)
+        pure_names.insert(pure_functions[i]);
+
     for (const ExternalFunctionInfo &function_info : module_info.functions) {
         ExternalFunction function = (ExternalFunction) dlsym(handle, function_info.name.c_str());
         const char *dlsym_error = dlerror();
-        if (dlsym_error != NULL) {
+        ExternalFunctionV2 function_v2 = (ExternalFunctionV2) dlsym(handle, (function_info.name + "_v2").c_str());
+        dlerror();
+        ExternalFunctionV2Batch function_v2_batch = (ExternalFunctionV2Batch) dlsym(handle, (function_info.name + "_v2_batch").c_str());
+        dlerror();
+        if (dlsym_error != NULL && function_v2 == NULL) {
             cerr << "Cannot find function '" << function_info.name << "' in "
                  << module_filename << ": " << dlsym_error << endl;
             // utils::exit_with(utils::ExitCode::CRITICAL_ERROR);
             exit(1);
         }
+        if (function_v2 != NULL)
+            cout << "Using v2 ABI for function " << function_info.name << endl;
 
         for (const GroundedExternalFunctionInfo &instance_info : function_info.instances) {
-            GroundedExternalFunction instance = make_pair(function, instance_info.parameters);
-            if (functions.count(instance_info.var) > 0) {
+            GroundedExternalFunction instance;
+            instance.function = function;
+            instance.function_v2 = function_v2;
+            instance.function_v2_batch = function_v2 != NULL ? function_v2_batch : NULL;
+            instance.parameters = instance_info.parameters;
+            for (const string &parameter : instance_info.parameters) {
+                ExternalFunctionArg arg;
+                char *end;
+                arg.number = strtod(parameter.c_str(), &end);
+                arg.is_number = !parameter.empty() && *end == '\0';
+                arg.object = arg.is_number ? -1 : intern_object(parameter);
+                if (!arg.is_number)
+                    arg.number = 0;
+                instance.args.push_back(arg);
+            }
+            instance.pure = pure_names.count(function_info.name) > 0;
+            instance.cached = false;
+            instance.cached_value = 0;
+            if (function_index.count(instance_info.var) > 0) {
                 cerr << "Duplicate external function instance for variable: " << instance_info.var << endl;
                 // utils::exit_with(utils::ExitCode::INPUT_ERROR);
                 exit(1);
             }
-            functions[instance_info.var] = instance;
-            std::cout << "external function #" << instance_info.var << ", " << instance_info.name << ": " << compute_function(instance_info.var) << endl;
+            function_index[instance_info.var] = function_table.size();
+            function_table.push_back(instance);
+            // v2 functions depend on the numeric state, they are first evaluated during search
+            if (function_v2 == NULL)
+                std::cout << "external function #" << instance_info.var << ", " << instance_info.name << ": " << compute_function(instance_info.var, vector<float>()) << endl;
+        }
+    }
+
+    SetupFunctionV2 setup_v2_function = (SetupFunctionV2) dlsym(handle, "setup_v2");
+    dlerror();
+    if (setup_v2_function != NULL) {
+        vector<const char *> objects;
+        for (const string &object : interned_objects)
+            objects.push_back(object.c_str());
+        setup_v2_function(objects.empty() ? NULL : &objects[0], objects.size());
+    }
+}
+
+size_t ExternalFunctionManager::state_cache_key(int index, const vector<float> &numeric_vars) {
+    size_t key = index;
+    for (float value : numeric_vars)
+        key = key * 31 + hash<float>()(value);
+    return key;
+}
+
+bool ExternalFunctionManager::lookup_state_cache(size_t key, int index,
+                                                 const vector<float> &numeric_vars, double &value) {
+    auto range = state_cache_index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        StateCacheList::iterator entry = it->second;
+        if (entry->index == index && entry->numeric_vars == numeric_vars) {
+            // Move to the front of the LRU list
+            state_cache.splice(state_cache.begin(), state_cache, entry);
+            value = entry->value;
+            return true;
         }
     }
+    return false;
+}
+
+void ExternalFunctionManager::insert_state_cache(size_t key, int index,
+                                                 const vector<float> &numeric_vars, double value) {
+    if (state_cache.size() >= state_cache_capacity) {
+        // Evict the least recently used entry
+        StateCacheEntry &last = state_cache.back();
+        size_t last_key = state_cache_key(last.index, last.numeric_vars);
+        auto range = state_cache_index.equal_range(last_key);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (&*it->second == &last) {
+                state_cache_index.erase(it);
+                break;
+            }
+        }
+        state_cache.pop_back();
+    }
+    StateCacheEntry entry;
+    entry.index = index;
+    entry.numeric_vars = numeric_vars;
+    entry.value = value;
+    state_cache.push_front(entry);
+    state_cache_index.insert(make_pair(key, state_cache.begin()));
+}
+
+double ExternalFunctionManager::call_function(const GroundedExternalFunction &instance,
+                                              const vector<float> &numeric_vars) {
+    float res;
+    if (instance.function_v2 != NULL)
+        res = instance.function_v2(instance.args.empty() ? NULL : &instance.args[0], instance.args.size(),
+                                   numeric_vars.empty() ? NULL : &numeric_vars[0], numeric_vars.size());
+    else
+        res = instance.function(instance.parameters);
+    return res;
+}
+
+double ExternalFunctionManager::compute_v2(int index, const vector<float> &numeric_vars) {
+    const GroundedExternalFunction &instance = function_table[index];
+    size_t key = 0;
+    double value;
+    if (instance.pure) {
+        key = state_cache_key(index, numeric_vars);
+        if (lookup_state_cache(key, index, numeric_vars, value))
+            return value;
+    }
+    double res = call_function(instance, numeric_vars);
+    if (instance.pure)
+        insert_state_cache(key, index, numeric_vars, res);
+    return res;
+}
+
+double ExternalFunctionManager::compute_uncached(int index, const vector<float> &numeric_vars) {
+    GroundedExternalFunction &instance = function_table[index];
+    double res;
+    if (!pending.empty() && take_pending(index, numeric_vars, res)) {
+        if (instance.pure && instance.function_v2 != NULL)
+            insert_state_cache(state_cache_key(index, numeric_vars), index, numeric_vars, res);
+    } else if (instance.function_v2 != NULL) {
+        return compute_v2(index, numeric_vars);
+    } else {
+        res = call_function(instance, numeric_vars);
+    }
+    if (instance.pure && instance.function_v2 == NULL) {
+        instance.cached = true;
+        instance.cached_value = res;
+    }
+    return res;
 }
 
-double ExternalFunctionManager::compute_function(int variable_id) {
-    if (functions.count(variable_id) == 0) {
+void ExternalFunctionManager::start_workers(int num_workers) {
+    stopping = false;
+    for (int i = 0; i < num_workers; i++)
+        workers.push_back(thread(&ExternalFunctionManager::worker_loop, this));
+    cout << "Evaluating external functions asynchronously with "
+         << num_workers << " worker(s)" << endl;
+}
+
+void ExternalFunctionManager::stop_workers() {
+    {
+        lock_guard<mutex> lock(work_mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+    for (thread &worker : workers)
+        worker.join();
+    workers.clear();
+    work_queue.clear();
+}
+
+void ExternalFunctionManager::worker_loop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(work_mutex);
+            work_available.wait(lock, [this] {return stopping || !work_queue.empty();});
+            if (stopping)
+                return;
+            task = work_queue.front();
+            work_queue.pop_front();
+        }
+        task();
+    }
+}
+
+ExternalFunctionManager::PendingList::iterator ExternalFunctionManager::find_pending(
+    size_t key, int index, const vector<float> &numeric_vars) {
+    auto range = pending_index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+        if (it->second->index == index && it->second->numeric_vars == numeric_vars)
+            return it->second;
+    return pending.end();
+}
+
+bool ExternalFunctionManager::take_pending(int index, const vector<float> &numeric_vars, double &value) {
+    size_t key = state_cache_key(index, numeric_vars);
+    PendingList::iterator entry = find_pending(key, index, numeric_vars);
+    if (entry == pending.end())
+        return false;
+    value = entry->result.get();
+    auto range = pending_index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == entry) {
+            pending_index.erase(it);
+            break;
+        }
+    }
+    pending.erase(entry);
+    return true;
+}
+
+void ExternalFunctionManager::prefetch(const vector<int> &indices, const vector<float> &numeric_vars) {
+    if (workers.empty())
+        return;
+    shared_ptr<const vector<float> > state;
+    for (int index : indices) {
+        const GroundedExternalFunction &instance = function_table[index];
+        if (instance.cached)
+            continue;
+        size_t key = state_cache_key(index, numeric_vars);
+        double value;
+        if (instance.pure && instance.function_v2 != NULL &&
+            lookup_state_cache(key, index, numeric_vars, value))
+            continue;
+        if (find_pending(key, index, numeric_vars) != pending.end())
+            continue;
+
+        if (!state)
+            state = make_shared<const vector<float> >(numeric_vars);
+        shared_ptr<packaged_task<double()> > task = make_shared<packaged_task<double()> >(
+            [&instance, state] {return call_function(instance, *state);});
+        PendingEvaluation evaluation;
+        evaluation.index = index;
+        evaluation.numeric_vars = numeric_vars;
+        evaluation.result = task->get_future().share();
+        pending.push_back(evaluation);
+        pending_index.insert(make_pair(key, --pending.end()));
+        {
+            lock_guard<mutex> lock(work_mutex);
+            work_queue.push_back([task] {(*task)();});
+        }
+        work_available.notify_one();
+
+        // Forget the oldest evaluations, the search went elsewhere
+        if (pending.size() > pending_capacity) {
+            const PendingEvaluation &oldest = pending.front();
+            size_t oldest_key = state_cache_key(oldest.index, oldest.numeric_vars);
+            auto range = pending_index.equal_range(oldest_key);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == pending.begin()) {
+                    pending_index.erase(it);
+                    break;
+                }
+            }
+            pending.pop_front();
+        }
+    }
+}
+
+void ExternalFunctionManager::compute_functions_at(const vector<int> &indices,
+                                                   const vector<float> &numeric_vars,
+                                                   vector<double> &results) {
+    results.resize(indices.size());
+    // Group the instances of each batched function, compute the others one by one
+    unordered_map<ExternalFunctionV2Batch, vector<int> > batches;
+    for (int i = 0; i < indices.size(); i++) {
+        const GroundedExternalFunction &instance = function_table[indices[i]];
+        if (instance.function_v2_batch != NULL && !instance.pure &&
+            (pending.empty() || !take_pending(indices[i], numeric_vars, results[i])))
+            batches[instance.function_v2_batch].push_back(i);
+        else if (instance.function_v2_batch == NULL || instance.pure)
+            results[i] = compute_function_at(indices[i], numeric_vars);
+    }
+
+    vector<const ExternalFunctionArg *> args;
+    vector<int> num_args;
+    vector<double> batch_results;
+    for (auto &batch : batches) {
+        const vector<int> &positions = batch.second;
+        args.clear();
+        num_args.clear();
+        for (int position : positions) {
+            const GroundedExternalFunction &instance = function_table[indices[position]];
+            args.push_back(instance.args.empty() ? NULL : &instance.args[0]);
+            num_args.push_back(instance.args.size());
+        }
+        batch_results.assign(positions.size(), 0);
+        batch.first(&args[0], &num_args[0], positions.size(),
+                    numeric_vars.empty() ? NULL : &numeric_vars[0], numeric_vars.size(),
+                    &batch_results[0]);
+        for (int j = 0; j < positions.size(); j++)
+            results[positions[j]] = float(batch_results[j]);
+    }
+}
+
+double ExternalFunctionManager::compute_function(int variable_id, const vector<float> &numeric_vars) {
+    int index = get_function_index(variable_id);
+    if (index == -1) {
         cerr << "No external function loaded for variable: " << variable_id << endl;
         // utils::exit_with(utils::ExitCode::CRITICAL_ERROR);
         exit(1);
     }
-    const GroundedExternalFunction &instance = functions[variable_id];
-    float res = instance.first(instance.second);
     // cout << "Res computed: " << res << endl;
-    return res;
+    return compute_function_at(index, numeric_vars);
 }
@@ -1,7 +1,14 @@
 #ifndef EXTERNAL_FUNCTIONS_H
 #define EXTERNAL_FUNCTIONS_H
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -23,19 +30,124 @@ struct ExternalFunctionModuleInfo {
     std::vector<ExternalFunctionInfo> functions;
 };
 
+/* Version 2 ABI (optional, looked up per function with dlsym).
+
+   A function f of a module may export, in addition to or instead of the
+   v1 entry point double f(const std::vector<std::string> &),
+     double f_v2(const ExternalFunctionArg *args, int num_args,
+                 const float *numeric_vars, int num_numeric_vars);
+   and optionally a batched entry point evaluating several instances
+     void f_v2_batch(const ExternalFunctionArg *const *args, const int *num_args,
+                     int count, const float *numeric_vars, int num_numeric_vars,
+                     double *results);
+   Arguments are parsed once at load: numbers are passed as doubles and any
+   other argument as an interned object id. The names of the ids are given
+   to the optional void setup_v2(const char *const *objects, int num_objects)
+   of the module. numeric_vars is a read-only view of the numeric state. */
+struct ExternalFunctionArg {
+    int is_number;
+    int object;    // interned object id, if !is_number
+    double number; // value, if is_number
+};
+
 class ExternalFunctionManager {
     typedef double (*ExternalFunction)(const std::vector<std::string> &);
+    typedef double (*ExternalFunctionV2)(const ExternalFunctionArg *, int, const float *, int);
+    typedef void (*ExternalFunctionV2Batch)(const ExternalFunctionArg *const *, const int *,
+                                            int, const float *, int, double *);
     typedef void (*SetupFunction)();
-    using GroundedExternalFunction = std::pair<ExternalFunction, std::vector<std::string>>;
+    typedef void (*SetupFunctionV2)(const char *const *, int);
+    struct GroundedExternalFunction {
+        ExternalFunction function;
+        ExternalFunctionV2 function_v2; // preferred over function when available
+        ExternalFunctionV2Batch function_v2_batch;
+        std::vector<std::string> parameters;
+        std::vector<ExternalFunctionArg> args;
+        // Pure functions always return the same value for the same
+        // parameters (and, for v2 functions, the same numeric state), so
+        // their result is computed only once.
+        bool pure;
+        bool cached;
+        double cached_value;
+    };
     std::vector<void*> open_handles;
 
-    std::unordered_map<int, GroundedExternalFunction> functions;
+    std::vector<GroundedExternalFunction> function_table;
+    std::unordered_map<int, int> function_index; // variable id -> function_table index
+
+    std::vector<std::string> interned_objects;
+    std::unordered_map<std::string, int> interned_object_ids;
+
+    // LRU cache of pure v2 functions, keyed by instance and numeric state
+    struct StateCacheEntry {
+        int index;
+        std::vector<float> numeric_vars;
+        double value;
+    };
+    typedef std::list<StateCacheEntry> StateCacheList;
+    static const int state_cache_capacity = 4096;
+    StateCacheList state_cache;
+    std::unordered_multimap<size_t, StateCacheList::iterator> state_cache_index;
+
+    /* Asynchronous evaluation: prefetch() submits the evaluations the
+       search is about to need to a pool of worker threads, and the
+       results are picked up by compute_function_at() for the same
+       instance and numeric state. Only used when workers were started,
+       which requires the module functions to be thread-safe. */
+    struct PendingEvaluation {
+        int index;
+        std::vector<float> numeric_vars;
+        std::shared_future<double> result;
+    };
+    typedef std::list<PendingEvaluation> PendingList;
+    static const int pending_capacity = 4096;
+    PendingList pending;
+    std::unordered_multimap<size_t, PendingList::iterator> pending_index;
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > work_queue;
+    std::mutex work_mutex;
+    std::condition_variable work_available;
+    bool stopping = false;
+
+    void worker_loop();
+    void stop_workers();
+    PendingList::iterator find_pending(size_t key, int index, const std::vector<float> &numeric_vars);
+    bool take_pending(int index, const std::vector<float> &numeric_vars, double &value);
+
+    static double call_function(const GroundedExternalFunction &instance, const std::vector<float> &numeric_vars);
+    double compute_uncached(int index, const std::vector<float> &numeric_vars);
+    int intern_object(const std::string &name);
+    static size_t state_cache_key(int index, const std::vector<float> &numeric_vars);
+    bool lookup_state_cache(size_t key, int index, const std::vector<float> &numeric_vars, double &value);
+    void insert_state_cache(size_t key, int index, const std::vector<float> &numeric_vars, double value);
+    double compute_v2(int index, const std::vector<float> &numeric_vars);
 public:
     ~ExternalFunctionManager();
 
     void load_module(const ExternalFunctionModuleInfo &module_info);
 
-    double compute_function(int variable_id);
+    // Index in the function table, -1 if no function is loaded for the variable
+    int get_function_index(int variable_id) const {
+        std::unordered_map<int, int>::const_iterator it = function_index.find(variable_id);
+        return it == function_index.end() ? -1 : it->second;
+    }
+    // Direct call path for ids resolved after loading (see resolve_external_functions)
+    double compute_function_at(int index, const std::vector<float> &numeric_vars) {
+        const GroundedExternalFunction &instance = function_table[index];
+        if (instance.cached)
+            return instance.cached_value;
+        return compute_uncached(index, numeric_vars);
+    }
+    // Evaluates several instances on the same numeric state, using the
+    // batched entry points of v2 functions when available
+    void compute_functions_at(const std::vector<int> &indices,
+                              const std::vector<float> &numeric_vars,
+                              std::vector<double> &results);
+    double compute_function(int variable_id, const std::vector<float> &numeric_vars);
+
+    void start_workers(int num_workers);
+    bool has_workers() const {return !workers.empty();}
+    void prefetch(const std::vector<int> &indices, const std::vector<float> &numeric_vars);
     void clear();
 };
 
@@ -27,8 +27,10 @@
 #include "operator.h"
 #include "state.h"
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
+#include <limits>
 
 using namespace std;
 using namespace __gnu_cxx;
@@ -51,14 +53,21 @@ FFHeuristic::FFHeuristic(bool use_cache)
     // Build goal propositions.
     // propositions that are goals are set to goal
     //    condition and termination condition
-    // goal propositions are direct references to goals in the propositions array
-    // termination_propositions are direct references to goals in the propositions array
+    // goal propositions are ids of goals in the propositions array
+    // termination_propositions are ids of goals in the propositions array
+    prop_offset.resize(g_variable_domain.size());
+    int num_propositions = 0;
+    for(int var = 0; var < g_variable_domain.size(); var++) {
+	prop_offset[var] = num_propositions;
+	num_propositions += g_variable_domain[var];
+    }
+    prop_is_termination.assign(num_propositions, false);
     for(int i = 0; i < g_goal.size(); i++) {
     	int var = g_goal[i].first, val = g_goal[i].second;
     	propositions[var][val].is_goal_condition = true;
-    	propositions[var][val].is_termination_condition = true;
-    	goal_propositions.push_back(&propositions[var][val]);
-    	termination_propositions.push_back(&propositions[var][val]);
+    	prop_is_termination[get_prop_id(var, val)] = true;
+    	goal_propositions.push_back(get_prop_id(var, val));
+    	termination_propositions.push_back(get_prop_id(var, val));
     }
 
     // Build unary operators for operators and axioms.
@@ -67,12 +76,8 @@ FFHeuristic::FFHeuristic(bool use_cache)
     for(int i = 0; i < g_axioms.size(); i++)
     	build_unary_operators(g_axioms[i]);
 
-    // Cross-reference unary operators.
-    for(int i = 0; i < unary_operators.size(); i++) {
-	UnaryOperator *op = &unary_operators[i];
-	for(int j = 0; j < op->precondition.size(); j++)
-	    op->precondition[j]->precondition_of.push_back(op);
-    }
+    prune_unary_operators();
+    compile_exploration_data();
     // Set flag that before heuristic values can be used, computation 
     // (relaxed exploration) needs to be done
     heuristic_recomputation_needed = true;
@@ -81,24 +86,173 @@ FFHeuristic::FFHeuristic(bool use_cache)
 FFHeuristic::~FFHeuristic() {
 }
 
+void FFHeuristic::compile_exploration_data() {
+    int num_propositions = prop_is_termination.size();
+    int num_unary_ops = unary_operators.size();
+
+    prop_var.resize(num_propositions);
+    prop_val.resize(num_propositions);
+    for(int var = 0; var < propositions.size(); var++) {
+	for(int val = 0; val < propositions[var].size(); val++) {
+	    prop_var[get_prop_id(var, val)] = var;
+	    prop_val[get_prop_id(var, val)] = val;
+	}
+    }
+
+    // Preconditions and effects of the unary operators
+    op_pre_begin.resize(num_unary_ops + 1);
+    op_pre.clear();
+    op_effect.resize(num_unary_ops);
+    op_base_cost.resize(num_unary_ops);
+    op_is_axiom.resize(num_unary_ops);
+    op_operator_index.resize(num_unary_ops);
+    vector<int> num_triggers(num_propositions, 0);
+    precondition_free_operators.clear();
+    for(int i = 0; i < num_unary_ops; i++) {
+	const UnaryOperator &op = unary_operators[i];
+	op_pre_begin[i] = op_pre.size();
+	for(int j = 0; j < op.precondition.size(); j++) {
+	    int pre = get_prop_id(op.precondition[j]->var, op.precondition[j]->val);
+	    op_pre.push_back(pre);
+	    num_triggers[pre]++;
+	}
+	op_effect[i] = get_prop_id(op.effect->var, op.effect->val);
+	op_base_cost[i] = op.base_cost;
+	op_is_axiom[i] = op.op->is_axiom();
+	op_operator_index[i] = op.op->is_axiom() ? -1 : op.op - &g_operators[0];
+	if(op.precondition.empty())
+	    precondition_free_operators.push_back(i);
+    }
+    op_pre_begin[num_unary_ops] = op_pre.size();
+
+    // Numeric conditions and effects
+    int num_vars = g_variable_domain.size();
+    op_num_pre_begin.resize(num_unary_ops + 1);
+    op_num_pre.clear();
+    cond_var.clear();
+    cond_greater.clear();
+    cond_value.clear();
+    cond_op.clear();
+    op_num_effect.resize(num_unary_ops);
+    op_num_var.resize(num_unary_ops);
+    op_num_amount.resize(num_unary_ops);
+    op_num_amount_known.resize(num_unary_ops);
+    vector<int> num_var_conds(num_vars, 0);
+    for(int i = 0; i < num_unary_ops; i++) {
+	const UnaryOperator &op = unary_operators[i];
+	op_num_pre_begin[i] = op_num_pre.size();
+	for(int j = 0; j < op.numeric_precondition.size(); j++) {
+	    const NumericCondition &cond = op.numeric_precondition[j];
+	    op_num_pre.push_back(cond_var.size());
+	    cond_var.push_back(cond.var);
+	    cond_greater.push_back(cond.op == GREAT_THAN);
+	    cond_value.push_back(cond.value);
+	    cond_op.push_back(i);
+	    num_var_conds[cond.var]++;
+	}
+	op_num_effect[i] = op.numeric_effect;
+	op_num_var[i] = op.numeric_var;
+	op_num_amount[i] = op.numeric_amount;
+	op_num_amount_known[i] = op.numeric_amount_known;
+    }
+    op_num_pre_begin[num_unary_ops] = op_num_pre.size();
+    var_cond_begin.assign(num_vars + 1, 0);
+    for(int var = 0; var < num_vars; var++)
+	var_cond_begin[var + 1] = var_cond_begin[var] + num_var_conds[var];
+    var_conds.resize(cond_var.size());
+    vector<int> next_cond(var_cond_begin.begin(), var_cond_begin.end() - 1);
+    for(int cond = 0; cond < cond_var.size(); cond++)
+	var_conds[next_cond[cond_var[cond]]++] = cond;
+
+    var_lo.assign(num_vars, 0);
+    var_hi.assign(num_vars, 0);
+    cond_epoch.assign(cond_var.size(), -1);
+    cond_achiever.assign(cond_var.size(), -1);
+    cond_plan_epoch.assign(cond_var.size(), -1);
+    op_numeric_unsatisfied.assign(num_unary_ops, 0);
+
+    // Cross-reference unary operators.
+    prop_all_trigger_begin.assign(num_propositions + 1, 0);
+    for(int p = 0; p < num_propositions; p++)
+	prop_all_trigger_begin[p + 1] = prop_all_trigger_begin[p] + num_triggers[p];
+    prop_all_triggers.resize(op_pre.size());
+    vector<int> next_trigger(prop_all_trigger_begin.begin(), prop_all_trigger_begin.end() - 1);
+    for(int i = 0; i < num_unary_ops; i++)
+	for(int j = op_pre_begin[i]; j < op_pre_begin[i + 1]; j++)
+	    prop_all_triggers[next_trigger[op_pre[j]]++] = i;
+
+    prop_trigger_begin.assign(num_propositions + 1, 0);
+    prop_triggers.clear();
+    for(int p = 0; p < num_propositions; p++) {
+	prop_trigger_begin[p] = prop_triggers.size();
+	for(int i = prop_all_trigger_begin[p]; i < prop_all_trigger_begin[p + 1]; i++)
+	    if(!op_pruned[prop_all_triggers[i]])
+		prop_triggers.push_back(prop_all_triggers[i]);
+    }
+    prop_trigger_begin[num_propositions] = prop_triggers.size();
+    explore_all_operators = false;
+
+    prop_h_add_cost.assign(num_propositions, -1);
+    prop_h_max_cost.assign(num_propositions, -1);
+    prop_depth.assign(num_propositions, -1);
+    prop_reached_by.assign(num_propositions, -1);
+    prop_marked.assign(num_propositions, false);
+    prop_epoch.assign(num_propositions, -1);
+
+    op_unsatisfied_preconditions.assign(num_unary_ops, 0);
+    op_h_add_cost.assign(num_unary_ops, 0);
+    op_h_max_cost.assign(num_unary_ops, 0);
+    op_depth.assign(num_unary_ops, -1);
+    op_epoch.assign(num_unary_ops, -1);
+
+    exploration_epoch = 0;
+    touched_propositions.clear();
+
+    plan_epoch = 0;
+    operator_plan_epoch.assign(g_operators.size(), -1);
+    prop_plan_epoch.assign(num_propositions, -1);
+    relaxed_plan_size = 0;
+    relaxed_plan_cost = 0;
+}
+
+void FFHeuristic::clear_relaxed_plan() {
+    if(++plan_epoch == INT_MAX) {
+	operator_plan_epoch.assign(operator_plan_epoch.size(), -1);
+	prop_plan_epoch.assign(prop_plan_epoch.size(), -1);
+	cond_plan_epoch.assign(cond_plan_epoch.size(), -1);
+	plan_epoch = 0;
+    }
+    relaxed_plan_size = 0;
+    relaxed_plan_cost = 0;
+}
+
+bool FFHeuristic::add_to_relaxed_plan(int unary_op) {
+    // Returns true if the operator was not yet part of the relaxed plan
+    int op_index = op_operator_index[unary_op];
+    if(op_index == -1 || operator_plan_epoch[op_index] == plan_epoch)
+	return false;
+    operator_plan_epoch[op_index] = plan_epoch;
+    relaxed_plan_size++;
+    relaxed_plan_cost += g_operators[op_index].get_cost();
+    return true;
+}
+
 void FFHeuristic::set_additional_goals(const std::vector<pair<int, int> >& add_goals) {
     //Clear previous additional goals.
-    for(int i = 0; i < termination_propositions.size(); i++) {
-	int var = termination_propositions[i]->var, val = termination_propositions[i]->val;
-	propositions[var][val].is_termination_condition = false;
-    }
+    for(int i = 0; i < termination_propositions.size(); i++)
+	prop_is_termination[termination_propositions[i]] = false;
     termination_propositions.clear();
     for(int i = 0; i < g_goal.size(); i++) {
-	int var = g_goal[i].first, val = g_goal[i].second;
-	propositions[var][val].is_termination_condition = true;
-	termination_propositions.push_back(&propositions[var][val]);
+	int prop = get_prop_id(g_goal[i].first, g_goal[i].second);
+	prop_is_termination[prop] = true;
+	termination_propositions.push_back(prop);
     }
     // Build new additional goal propositions.
     for(int i = 0; i < add_goals.size(); i++) {
 	int var = add_goals[i].first, val = add_goals[i].second;
 	if(!propositions[var][val].is_goal_condition) {
-	    propositions[var][val].is_termination_condition = true;
-	    termination_propositions.push_back(&propositions[var][val]);
+	    prop_is_termination[get_prop_id(var, val)] = true;
+	    termination_propositions.push_back(get_prop_id(var, val));
 	}
     }
     heuristic_recomputation_needed = true;
@@ -113,6 +267,17 @@ void FFHeuristic::build_unary_operators(const Operator &op) {
     const vector<PrePost> &pre_post = op.get_pre_post();
     vector<Proposition *> precondition;
     vector<pair<int,int> > precondition_var_vals1;
+    vector<NumericCondition> numeric_conditions;
+
+    for(int i = 0; i < pre_post.size(); i++) {
+	// Conditions on runtime values cannot be bounded, they are relaxed away
+	if(pre_post[i].have_runtime_cost_effect || pre_post[i].have_module_cost_effect)
+	    continue;
+	if(pre_post[i].pre == -5)
+	    numeric_conditions.push_back(NumericCondition(pre_post[i].var, GREAT_THAN, pre_post[i].f_cost));
+	else if(pre_post[i].pre == -6)
+	    numeric_conditions.push_back(NumericCondition(pre_post[i].var, LESS_THAN, pre_post[i].f_cost));
+    }
 
     for(int i = 0; i < prevail.size(); i++) {
 	assert(prevail[i].var >= 0 && prevail[i].var < g_variable_domain.size());
@@ -167,6 +332,16 @@ void FFHeuristic::build_unary_operators(const Operator &op) {
                                    [precondition_var_vals2[j].second]);
 
 		unary_operators.push_back(UnaryOperator(precondition, effect, &op, base_cost));
+		UnaryOperator &unary_op = unary_operators.back();
+		unary_op.numeric_precondition = numeric_conditions;
+		if(pre_post[i].pre == -2 || pre_post[i].pre == -3 || pre_post[i].pre == -4) {
+		    unary_op.numeric_effect = pre_post[i].pre == -2 ? INCREASE :
+			(pre_post[i].pre == -3 ? DECREASE : ASSIGN);
+		    unary_op.numeric_var = pre_post[i].var;
+		    unary_op.numeric_amount = pre_post[i].f_cost;
+		    unary_op.numeric_amount_known = !pre_post[i].have_runtime_cost_effect &&
+			!pre_post[i].have_module_cost_effect;
+		}
 		// precondition.erase(precondition.end() - eff_cond.size(), precondition.end());
 		precondition.clear();
 		precondition_var_vals2.clear();
@@ -184,61 +359,283 @@ public:
     }
 };
 
+static bool proposition_ptr_less(const Proposition *p1, const Proposition *p2) {
+    return *p1 < *p2;
+}
+
+void FFHeuristic::prune_unary_operators() {
+    // Operators with numeric conditions or effects are always kept.
+    int num_unary_ops = unary_operators.size();
+    op_pruned.assign(num_unary_ops, false);
+    int num_duplicates = 0, num_dominated = 0;
+
+    // Duplicates: keep the cheapest, the first one among equally cheap ones
+    typedef pair<vector<Proposition *>, Proposition *> UnaryOperatorKey;
+    hash_map<UnaryOperatorKey, int, hash_unary_operator> representative;
+    for(int i = 0; i < num_unary_ops; i++) {
+	const UnaryOperator &op = unary_operators[i];
+	if(op.numeric_effect != NO_OPP || !op.numeric_precondition.empty())
+	    continue;
+	UnaryOperatorKey key = make_pair(op.precondition, op.effect);
+	hash_map<UnaryOperatorKey, int, hash_unary_operator>::iterator it = representative.find(key);
+	if(it == representative.end()) {
+	    representative[key] = i;
+	} else if(unary_operators[it->second].base_cost <= op.base_cost) {
+	    op_pruned[i] = true;
+	    num_duplicates++;
+	} else {
+	    op_pruned[it->second] = true;
+	    num_duplicates++;
+	    it->second = i;
+	}
+    }
+
+    // Dominance among the remaining achievers of each effect. A dominating
+    // achiever has strictly fewer preconditions, so the achievers are visited
+    // by increasing precondition count and only compared with the ones kept
+    // so far (dominance is transitive, pruned ones add nothing). These are
+    // indexed by their first precondition, NULL if they have none: it is a
+    // precondition of every operator they dominate, so the candidates of an
+    // operator are in the buckets of its own preconditions and of NULL.
+    hash_map<Proposition *, vector<int>, hash_pointer> achievers;
+    for(int i = 0; i < num_unary_ops; i++) {
+	const UnaryOperator &op = unary_operators[i];
+	if(!op_pruned[i] && op.numeric_effect == NO_OPP && op.numeric_precondition.empty())
+	    achievers[op.effect].push_back(i);
+    }
+    hash_map<Proposition *, vector<int>, hash_pointer> kept_by_first_pre;
+    hash_map<Proposition *, vector<int>, hash_pointer>::iterator it;
+    for(it = achievers.begin(); it != achievers.end(); ++it) {
+	vector<int> &ops = it->second;
+	stable_sort(ops.begin(), ops.end(), [this](int op1, int op2) {
+	    return unary_operators[op1].precondition.size() <
+		unary_operators[op2].precondition.size();
+	});
+	kept_by_first_pre.clear();
+	for(int i = 0; i < ops.size(); i++) {
+	    const UnaryOperator &dominated = unary_operators[ops[i]];
+	    bool is_dominated = false;
+	    for(int p = -1; !is_dominated && p < int(dominated.precondition.size()); p++) {
+		Proposition *first_pre = p == -1 ? NULL : dominated.precondition[p];
+		hash_map<Proposition *, vector<int>, hash_pointer>::const_iterator bucket =
+		    kept_by_first_pre.find(first_pre);
+		if(bucket == kept_by_first_pre.end())
+		    continue;
+		const vector<int> &candidates = bucket->second;
+		for(int j = 0; j < candidates.size(); j++) {
+		    const UnaryOperator &dominating = unary_operators[candidates[j]];
+		    if(dominating.precondition.size() >= dominated.precondition.size() ||
+		       dominating.base_cost > dominated.base_cost)
+			continue;
+		    // Preconditions are sorted by variable and value
+		    if(includes(dominated.precondition.begin(), dominated.precondition.end(),
+				dominating.precondition.begin(), dominating.precondition.end(),
+				proposition_ptr_less)) {
+			is_dominated = true;
+			break;
+		    }
+		}
+	    }
+	    if(is_dominated) {
+		op_pruned[ops[i]] = true;
+		num_dominated++;
+	    } else {
+		Proposition *first_pre = dominated.precondition.empty() ? NULL : dominated.precondition[0];
+		kept_by_first_pre[first_pre].push_back(ops[i]);
+	    }
+	}
+    }
+
+    cout << "Pruned " << num_duplicates + num_dominated << " of " << num_unary_ops
+	 << " unary operators (" << num_duplicates << " duplicate, "
+	 << num_dominated << " dominated)" << endl;
+}
+
 // heuristic computation
+void FFHeuristic::start_exploration() {
+    reachable_queue.clear();
+
+    // Reset the propositions changed by the previous exploration
+    for(int i = 0; i < touched_propositions.size(); i++) {
+	int prop = touched_propositions[i];
+	prop_h_add_cost[prop] = -1;
+	prop_h_max_cost[prop] = -1;
+	prop_depth[prop] = -1;
+	prop_marked[prop] = false;
+    }
+    touched_propositions.clear();
+
+    if(++exploration_epoch == INT_MAX) {
+	prop_epoch.assign(prop_epoch.size(), -1);
+	op_epoch.assign(op_epoch.size(), -1);
+	cond_epoch.assign(cond_epoch.size(), -1);
+	exploration_epoch = 0;
+    }
+}
+
+void FFHeuristic::setup_numeric_bounds(const State &state) {
+    if(cond_var.empty())
+	return;
+    for(int var = 0; var < var_lo.size(); var++) {
+	var_lo[var] = state.numeric_vars_val[var];
+	var_hi[var] = state.numeric_vars_val[var];
+    }
+    for(int cond = 0; cond < cond_var.size(); cond++)
+	op_numeric_unsatisfied[cond_op[cond]] = 0;
+    for(int cond = 0; cond < cond_var.size(); cond++) {
+	cond_achiever[cond] = -1;
+	if(condition_holds(cond))
+	    cond_epoch[cond] = exploration_epoch;
+	else
+	    op_numeric_unsatisfied[cond_op[cond]]++;
+    }
+}
+
+void FFHeuristic::apply_unary_operator(int op, int cost, int depth, bool use_h_max) {
+    enqueue_if_necessary(op_effect[op], cost, depth, op, use_h_max);
+    if(op_num_effect[op] == NO_OPP || cond_var.empty())
+	return;
+    numeric_worklist.clear();
+    numeric_worklist.push_back(op);
+    while(!numeric_worklist.empty()) {
+	int next = numeric_worklist.back();
+	numeric_worklist.pop_back();
+	widen_numeric_bounds(next, use_h_max);
+    }
+}
+
+void FFHeuristic::widen_numeric_bounds(int op, bool use_h_max) {
+    const float infinity = numeric_limits<float>::infinity();
+    int var = op_num_var[op];
+    float amount = op_num_amount[op];
+    float old_lo = var_lo[var], old_hi = var_hi[var];
+    if(!op_num_amount_known[op]) {
+	var_lo[var] = -infinity;
+	var_hi[var] = infinity;
+    } else if(op_num_effect[op] == ASSIGN) {
+	var_lo[var] = min(var_lo[var], amount);
+	var_hi[var] = max(var_hi[var], amount);
+    } else {
+	// Repeated application makes the bound unlimited in the direction of the change
+	if(op_num_effect[op] == DECREASE)
+	    amount = -amount;
+	if(amount > 0)
+	    var_hi[var] = infinity;
+	else if(amount < 0)
+	    var_lo[var] = -infinity;
+    }
+    if(var_lo[var] == old_lo && var_hi[var] == old_hi)
+	return;
+
+    int cost = use_h_max ? op_h_max_cost[op] : op_h_add_cost[op];
+    int depth = op_is_axiom[op] ? op_depth[op] : op_depth[op] + 1;
+    for(int i = var_cond_begin[var]; i < var_cond_begin[var + 1]; i++) {
+	int cond = var_conds[i];
+	if(cond_epoch[cond] == exploration_epoch || !condition_holds(cond))
+	    continue;
+	cond_epoch[cond] = exploration_epoch;
+	cond_achiever[cond] = op;
+
+	int unary_op = cond_op[cond];
+	if(op_epoch[unary_op] != exploration_epoch)
+	    init_unary_operator(unary_op);
+	if(op_h_add_cost[unary_op] == -2) // operator is not applied
+	    continue;
+	op_unsatisfied_preconditions[unary_op]--;
+	op_h_add_cost[unary_op] += cost;
+	op_h_max_cost[unary_op] = max(cost + op_base_cost[unary_op], op_h_max_cost[unary_op]);
+	op_depth[unary_op] = max(op_depth[unary_op], depth);
+	assert(op_unsatisfied_preconditions[unary_op] >= 0);
+	if(op_unsatisfied_preconditions[unary_op] == 0) {
+	    int op_depth_value = op_is_axiom[unary_op] ? op_depth[unary_op] : op_depth[unary_op] + 1;
+	    enqueue_if_necessary(op_effect[unary_op],
+				 use_h_max ? op_h_max_cost[unary_op] : op_h_add_cost[unary_op],
+				 op_depth_value, unary_op, use_h_max);
+	    if(op_num_effect[unary_op] != NO_OPP)
+		numeric_worklist.push_back(unary_op);
+	}
+    }
+}
+
+void FFHeuristic::setup_exploration_queue(const State &state, bool use_h_max) {
+    start_exploration();
+    setup_numeric_bounds(state);
+    explore_all_operators = false;
+
+    // Deal with current state.
+    for(int var = 0; var < propositions.size(); var++) {
+	if(state[var] != -1)
+	    enqueue_if_necessary(get_prop_id(var, state[var]), 0, 0, -1, use_h_max);
+    }
+
+    // Deal with precondition-free operators/axioms, the other operators
+    // are initialized when first triggered during relaxed exploration.
+    for(int i = 0; i < precondition_free_operators.size(); i++) {
+	int op = precondition_free_operators[i];
+	if(op_pruned[op])
+	    continue;
+	// Already reached by a numeric widening of an earlier operator here
+	if(op_epoch[op] == exploration_epoch)
+	    continue;
+	init_unary_operator(op);
+	if(op_unsatisfied_preconditions[op] != 0) // numeric conditions
+	    continue;
+	op_depth[op] = 0;
+	int depth = op_is_axiom[op] ? 0 : 1;
+	apply_unary_operator(op, op_base_cost[op], depth, use_h_max);
+    }
+}
+
 void FFHeuristic::setup_exploration_queue(const State &state, 
 					  const vector<pair<int, int> >& excluded_props,
 					  const hash_set<const Operator *, 
 					  hash_operator_ptr>& excluded_ops,
 					  bool use_h_max = false) {
-    reachable_queue.clear();
+    // Full initialization: callers read the costs of all unary operators
+    start_exploration();
+    setup_numeric_bounds(state);
 
-    for(int var = 0; var < propositions.size(); var++) {
-		for(int value = 0; value < propositions[var].size(); value++) {
-			Proposition &prop = propositions[var][value];
-			prop.h_add_cost = -1;
-			prop.h_max_cost = -1;
-			prop.depth = -1;
-			prop.marked = false;
-		}
-    }
     if(excluded_props.size() > 0) {
 	for(unsigned i = 0; i < excluded_props.size(); i++) {
-	    Proposition &prop = propositions[excluded_props[i].first][excluded_props[i].second];
-	    prop.h_add_cost = -2;
+	    int prop = get_prop_id(excluded_props[i].first, excluded_props[i].second);
+	    touch_proposition(prop);
+	    prop_h_add_cost[prop] = -2;
 	}
     }
 
     // Deal with current state.
     for(int var = 0; var < propositions.size(); var++) {
-		if (state[var] != -1){
-			Proposition *init_prop = &propositions[var][state[var]];
-			enqueue_if_necessary(init_prop, 0, 0, 0, use_h_max);
-		}
+	if(state[var] != -1)
+	    enqueue_if_necessary(get_prop_id(var, state[var]), 0, 0, -1, use_h_max);
+    }
+
+    // Initialize operator data and exclusions first: applying an operator
+    // may widen numeric bounds and so reach the conditions of later ones.
+    explore_all_operators = true;
+    for(int op = 0; op < unary_operators.size(); op++) {
+	init_unary_operator(op);
+	if(excluded_ops.size() > 0 && (prop_h_add_cost[op_effect[op]] == -2 ||
+			       excluded_ops.find(unary_operators[op].op) != excluded_ops.end()))
+	    op_h_add_cost[op] = -2; // operator will not be applied during relaxed exploration
     }
 
-    // Initialize operator data, deal with precondition-free operators/axioms.
-    for(int i = 0; i < unary_operators.size(); i++) {
-	UnaryOperator &op = unary_operators[i];
-	op.unsatisfied_preconditions = op.precondition.size();
-	if(excluded_ops.size() > 0 && (op.effect->h_add_cost == -2 || 
-			       excluded_ops.find(op.op) != excluded_ops.end())) {
-	    op.h_add_cost = -2; // operator will not be applied during relaxed exploration
+    // Deal with precondition-free operators/axioms.
+    for(int op = 0; op < unary_operators.size(); op++) {
+	if(op_h_add_cost[op] == -2)
 	    continue;
-	}
-	op.h_add_cost = op.base_cost; // will be increased by precondition costs
-	op.h_max_cost = op.base_cost;
-	op.depth = -1;
-
-	if(op.unsatisfied_preconditions == 0) {
-	    op.depth = 0;
-	    int depth = op.op->is_axiom() ? 0 : 1;
-	    enqueue_if_necessary(op.effect, op.base_cost, depth, &op, use_h_max);
+	if(op_unsatisfied_preconditions[op] == 0 && op_depth[op] == -1) {
+	    op_depth[op] = 0;
+	    int depth = op_is_axiom[op] ? 0 : 1;
+	    apply_unary_operator(op, op_base_cost[op], depth, use_h_max);
 	}
     }
 }
 
 void FFHeuristic::relaxed_exploration(bool use_h_max = false, bool level_out = false) {
     int unsolved_goals = termination_propositions.size();
+    const vector<int> &prop_cost_of = use_h_max ? prop_h_max_cost : prop_h_add_cost;
+    const vector<int> &trigger_begin = explore_all_operators ? prop_all_trigger_begin : prop_trigger_begin;
+    const vector<int> &triggers = explore_all_operators ? prop_all_triggers : prop_triggers;
     for(int distance = 0; distance < reachable_queue.size(); distance++) {
         for(;;) {
             Bucket &bucket = reachable_queue[distance];
@@ -247,76 +644,63 @@ void FFHeuristic::relaxed_exploration(bool use_h_max = false, bool level_out = f
             //       resized.
             if(bucket.empty())
                 break;
-            Proposition *prop = bucket.back();
+            int prop = bucket.back();
             bucket.pop_back();
-            int prop_cost;
-            if(use_h_max)
-            	prop_cost = prop->h_max_cost;
-            else
-            	prop_cost = prop->h_add_cost;
+            int prop_cost = prop_cost_of[prop];
             assert(prop_cost <= distance);
             if(prop_cost < distance)
             	continue;
-            if(!level_out && prop->is_termination_condition && --unsolved_goals == 0)
+            if(!level_out && prop_is_termination[prop] && --unsolved_goals == 0)
                 return;
-            const vector<UnaryOperator *> &triggered_operators = prop->precondition_of;
-            for(int i = 0; i < triggered_operators.size(); i++) {
-            	UnaryOperator *unary_op = triggered_operators[i];
-            	if(unary_op->h_add_cost == -2) // operator is not applied
+            int prop_depth_value = prop_depth[prop];
+            for(int i = trigger_begin[prop]; i < trigger_begin[prop + 1]; i++) {
+            	int unary_op = triggers[i];
+            	if(op_epoch[unary_op] != exploration_epoch)
+            		init_unary_operator(unary_op);
+            	if(op_h_add_cost[unary_op] == -2) // operator is not applied
             		continue;
-            	unary_op->unsatisfied_preconditions--;
-            	unary_op->h_add_cost += prop_cost;
-            	unary_op->h_max_cost = max(prop_cost + unary_op->base_cost,
-				unary_op->h_max_cost);
-            	unary_op->depth = max(unary_op->depth, prop->depth);
-            	assert(unary_op->unsatisfied_preconditions >= 0);
-            	if(unary_op->unsatisfied_preconditions == 0) {
-            		int depth = unary_op->op->is_axiom() ? unary_op->depth : unary_op->depth + 1;
+            	op_unsatisfied_preconditions[unary_op]--;
+            	op_h_add_cost[unary_op] += prop_cost;
+            	op_h_max_cost[unary_op] = max(prop_cost + op_base_cost[unary_op],
+				op_h_max_cost[unary_op]);
+            	op_depth[unary_op] = max(op_depth[unary_op], prop_depth_value);
+            	assert(op_unsatisfied_preconditions[unary_op] >= 0);
+            	if(op_unsatisfied_preconditions[unary_op] == 0) {
+            		int depth = op_is_axiom[unary_op] ? op_depth[unary_op] : op_depth[unary_op] + 1;
             		if(use_h_max)
-            			enqueue_if_necessary(unary_op->effect, unary_op->h_max_cost,
-					     depth, unary_op, use_h_max);
+            			apply_unary_operator(unary_op, op_h_max_cost[unary_op],
+					     depth, use_h_max);
             		else
-            			enqueue_if_necessary(unary_op->effect, unary_op->h_add_cost,
-					     depth, unary_op, use_h_max);
+            			apply_unary_operator(unary_op, op_h_add_cost[unary_op],
+					     depth, use_h_max);
             	}
             }
         }
     }
 }
 
-void FFHeuristic::enqueue_if_necessary(Proposition *prop, int cost, int depth, 
-				       UnaryOperator *op, 
+void FFHeuristic::enqueue_if_necessary(int prop, int cost, int depth,
+				       int op,
 				       bool use_h_max) {
     assert(cost >= 0);
-    if(use_h_max && (prop->h_max_cost == -1 || prop->h_max_cost > cost)) {
-	prop->h_max_cost = cost;
-	prop->depth = depth;
-	prop->reached_by = op;
+    vector<int> &prop_cost = use_h_max ? prop_h_max_cost : prop_h_add_cost;
+    if(prop_cost[prop] == -1 || prop_cost[prop] > cost) {
+	touch_proposition(prop);
+	prop_cost[prop] = cost;
+	prop_depth[prop] = depth;
+	prop_reached_by[prop] = op;
 	if(cost >= reachable_queue.size())
 	    reachable_queue.resize(cost + 1);
 	reachable_queue[cost].push_back(prop);
     }
-    else if(!use_h_max && (prop->h_add_cost == -1 || prop->h_add_cost > cost)) {
-	prop->h_add_cost = cost;
-	prop->depth = depth;
-	prop->reached_by = op;
-	if(cost >= reachable_queue.size())
-                reachable_queue.resize(cost + 1);
-	reachable_queue[cost].push_back(prop);
-    }
-    if(use_h_max)
-	assert(prop->h_max_cost != -1 &&
-	       prop->h_max_cost <= cost);
-    else
-	assert(prop->h_add_cost != -1 &&
-	       prop->h_add_cost <= cost);
+    assert(prop_cost[prop] != -1 && prop_cost[prop] <= cost);
 }
 
 
 int FFHeuristic::compute_hsp_add_heuristic() {
     int total_cost = 0;
     for(int i = 0; i < goal_propositions.size(); i++) {
-	int prop_cost = goal_propositions[i]->h_add_cost;
+	int prop_cost = prop_h_add_cost[goal_propositions[i]];
 	if(prop_cost == -1)
 	    return DEAD_END;
 	total_cost += prop_cost;
@@ -328,7 +712,7 @@ float FFHeuristic::compute_hsp_max_heuristic() {
 /* Note: this function is currently not used */
     int maximal_cost = 0;
     for(int i = 0; i < goal_propositions.size(); i++) {
-	int prop_cost = goal_propositions[i]->h_max_cost;
+	int prop_cost = prop_h_max_cost[goal_propositions[i]];
 	if(prop_cost == -1)
 	    return DEAD_END;
 	maximal_cost = max(maximal_cost, prop_cost);
@@ -350,44 +734,62 @@ int FFHeuristic::compute_ff_heuristic(const State &state) {
     if(h_add_heuristic == DEAD_END) {
 	return DEAD_END;
     } else {
-	relaxed_plan.clear();
+	clear_relaxed_plan();
 	// Collecting the relaxed plan also marks helpful actions as preferred.
 	for(int i = 0; i < goal_propositions.size(); i++)
-	    collect_relaxed_plan(goal_propositions[i], relaxed_plan, state);
+	    collect_relaxed_plan(goal_propositions[i], state);
 	if(!g_use_metric)
-	    return relaxed_plan.size();
-	else {
-	    int cost = 0;
-	    RelaxedPlan::iterator it = relaxed_plan.begin();
-	    for(; it != relaxed_plan.end(); ++it)
-		cost += (*it)->get_cost();
-	    return cost;
-	}
+	    return relaxed_plan_size;
+	else
+	    return relaxed_plan_cost;
     }
 }
 
-void FFHeuristic::collect_relaxed_plan(Proposition *goal,
-				       RelaxedPlan &relaxed_plan, const State &state) {
-
-    if (!goal->marked) { // Only consider each subgoal once.
-	goal->marked = true;
-	UnaryOperator *unary_op = goal->reached_by;
-	if(unary_op) { // We have not yet chained back to a start node.
-	    for(int i = 0; i < unary_op->precondition.size(); i++)
-		collect_relaxed_plan(unary_op->precondition[i], relaxed_plan, state);
-	    const Operator *op = unary_op->op;
-	    bool added_to_relaxed_plan = false;
-	    if(!op->is_axiom())
-		added_to_relaxed_plan = relaxed_plan.insert(op).second;
-
-	    assert(unary_op->depth != -1);
-	    if(added_to_relaxed_plan
-	       && unary_op->h_add_cost == unary_op->base_cost
-	       && unary_op->depth == 0
-	       && !op->is_axiom()) {
-		set_preferred(op);
-		assert(op->is_applicable(state));
+void FFHeuristic::collect_relaxed_plan(int goal, const State &state) {
+    // Depth-first through the achievers of goal, adding operators to the
+    // relaxed plan after their preconditions.
+    if(prop_marked[goal]) // Only consider each subgoal once.
+	return;
+    prop_marked[goal] = true;
+    if(prop_reached_by[goal] == -1) // Reached in the state.
+	return;
+    extraction_stack.clear();
+    extraction_stack.push_back(extraction_frame(prop_reached_by[goal]));
+    while(!extraction_stack.empty()) {
+	ExtractionFrame &frame = extraction_stack.back();
+	int unary_op = frame.unary_op;
+	if(frame.next_pre < op_pre_begin[unary_op + 1]) {
+	    int pre = op_pre[frame.next_pre++];
+	    if(!prop_marked[pre]) {
+		prop_marked[pre] = true;
+		int achiever = prop_reached_by[pre];
+		if(achiever != -1)
+		    extraction_stack.push_back(extraction_frame(achiever));
+	    }
+	    continue;
+	}
+	if(frame.next_num_pre < op_num_pre_begin[unary_op + 1]) {
+	    // Numeric conditions require the operator that widened the bounds
+	    int cond = op_num_pre[frame.next_num_pre++];
+	    if(cond_plan_epoch[cond] != plan_epoch) {
+		cond_plan_epoch[cond] = plan_epoch;
+		int achiever = cond_achiever[cond];
+		if(achiever != -1)
+		    extraction_stack.push_back(extraction_frame(achiever));
 	    }
+	    continue;
+	}
+	extraction_stack.pop_back();
+
+	bool added_to_relaxed_plan = add_to_relaxed_plan(unary_op);
+	assert(op_depth[unary_op] != -1);
+	if(added_to_relaxed_plan
+	   && op_h_add_cost[unary_op] == op_base_cost[unary_op]
+	   && op_depth[unary_op] == 0
+	   && !op_is_axiom[unary_op]) {
+	    const Operator *op = unary_operators[unary_op].op;
+	    set_preferred(op);
+	    assert(op->is_applicable(state));
 	}
     }
 }
@@ -407,9 +809,9 @@ compute_reachability_with_excludes(vector<vector<int> >& lvl_var,
     // Copy reachability information into lvl_var and lvl_op
     for(int var = 0; var < propositions.size(); var++) {
 	for(int value = 0; value < propositions[var].size(); value++) {
-	    Proposition &prop = propositions[var][value];
-	    if(prop.h_max_cost >= 0)
-		lvl_var[var][value] = prop.h_max_cost;
+	    int prop = get_prop_id(var, value);
+	    if(prop_h_max_cost[prop] >= 0)
+		lvl_var[var][value] = prop_h_max_cost[prop];
 	}
     }
     if(compute_lvl_ops) {
@@ -421,30 +823,29 @@ compute_reachability_with_excludes(vector<vector<int> >& lvl_var,
 	for(int i = 0; i < g_axioms.size(); i++) {
 	    operator_index.insert(make_pair(&g_axioms[i], i + offset));
 	}
-	for(int i = 0; i < unary_operators.size(); i++) {
-	    UnaryOperator &op = unary_operators[i];
+	for(int op = 0; op < unary_operators.size(); op++) {
 	    // H_max_cost of operator might be wrongly 0 or 1, if the operator 
 	    // did not get applied during relaxed exploration. Look through
 	    // preconditions and adjust.
-	    for(int i = 0; i < op.precondition.size(); i++) {
-		Proposition* prop = op.precondition[i];
-		if(prop->h_max_cost == -1) {
+	    for(int i = op_pre_begin[op]; i < op_pre_begin[op + 1]; i++) {
+		int prop = op_pre[i];
+		if(prop_h_max_cost[prop] == -1) {
 		    // Operator cannot be applied due to unreached precondition
-		    op.h_max_cost = INT_MAX;
+		    op_h_max_cost[op] = INT_MAX;
 		    break;
 		}
-		else if(op.h_max_cost < prop->h_max_cost + op.base_cost)
-		    op.h_max_cost = prop->h_max_cost + op.base_cost;
+		else if(op_h_max_cost[op] < prop_h_max_cost[prop] + op_base_cost[op])
+		    op_h_max_cost[op] = prop_h_max_cost[prop] + op_base_cost[op];
 	    }
-	    if(op.h_max_cost == INT_MAX)
+	    if(op_h_max_cost[op] == INT_MAX)
 		break;
-	    int op_index = operator_index[op.op];
+	    int op_index = operator_index[unary_operators[op].op];
 	    // We subtract 1 to keep semantics for landmark code:
 	    // if op can achieve prop at time step i+1,  
 	    // its index (for prop) is i, where the initial state is time step 0. 
-	    pair<int, int> effect = make_pair(op.effect->var, op.effect->val);
+	    pair<int, int> effect = make_pair(prop_var[op_effect[op]], prop_val[op_effect[op]]);
 	    assert(lvl_op[op_index].find(effect) != lvl_op[op_index].end());
-	    int new_lvl = op.h_max_cost - 1;
+	    int new_lvl = op_h_max_cost[op] - 1;
 	    // If we have found a cheaper achieving operator, adjust h_max cost of proposition.
 	    if(lvl_op[op_index].find(effect)->second > new_lvl)
 		lvl_op[op_index].find(effect)->second = new_lvl;
@@ -467,24 +868,51 @@ int FFHeuristic::compute_heuristic(const State &state) {
 }
 
 
-void FFHeuristic::collect_ha(Proposition *goal,
-                             RelaxedPlan &relaxed_plan, const State &state) {
+void FFHeuristic::collect_ha(int goal, const State &state) {
 
     // This is the same as collect_relaxed_plan, except that preferred operators
-    // are saved in exported_ops rather than preferred_operators
-
-    UnaryOperator *unary_op = goal->reached_by;
-    if(unary_op) { // We have not yet chained back to a start node.
-	for(int i = 0; i < unary_op->precondition.size(); i++)
-	    collect_ha(unary_op->precondition[i], relaxed_plan, state);
-	const Operator *op = unary_op->op;
-	bool added_to_relaxed_plan = false;
-	if(!op->is_axiom())
-	    added_to_relaxed_plan = relaxed_plan.insert(op).second;
+    // are saved in exported_ops rather than preferred_operators. Propositions
+    // are visited once per relaxed plan (a second visit could not add any
+    // operator), independently of the marks of collect_relaxed_plan.
+    if(prop_plan_epoch[goal] == plan_epoch)
+	return;
+    prop_plan_epoch[goal] = plan_epoch;
+    if(prop_reached_by[goal] == -1) // We have chained back to a start node.
+	return;
+    extraction_stack.clear();
+    extraction_stack.push_back(extraction_frame(prop_reached_by[goal]));
+    while(!extraction_stack.empty()) {
+	ExtractionFrame &frame = extraction_stack.back();
+	int unary_op = frame.unary_op;
+	if(frame.next_pre < op_pre_begin[unary_op + 1]) {
+	    int pre = op_pre[frame.next_pre++];
+	    if(prop_plan_epoch[pre] != plan_epoch) {
+		prop_plan_epoch[pre] = plan_epoch;
+		int achiever = prop_reached_by[pre];
+		if(achiever != -1)
+		    extraction_stack.push_back(extraction_frame(achiever));
+	    }
+	    continue;
+	}
+	if(frame.next_num_pre < op_num_pre_begin[unary_op + 1]) {
+	    // Numeric conditions require the operator that widened the bounds
+	    int cond = op_num_pre[frame.next_num_pre++];
+	    if(cond_plan_epoch[cond] != plan_epoch) {
+		cond_plan_epoch[cond] = plan_epoch;
+		int achiever = cond_achiever[cond];
+		if(achiever != -1)
+		    extraction_stack.push_back(extraction_frame(achiever));
+	    }
+	    continue;
+	}
+	extraction_stack.pop_back();
+
+	bool added_to_relaxed_plan = add_to_relaxed_plan(unary_op);
 	if(added_to_relaxed_plan
-	   && unary_op->h_add_cost == unary_op->base_cost
-	   && unary_op->depth == 0
-	   && !op->is_axiom()) {
+	   && op_h_add_cost[unary_op] == op_base_cost[unary_op]
+	   && op_depth[unary_op] == 0
+	   && !op_is_axiom[unary_op]) {
+	    const Operator *op = unary_operators[unary_op].op;
             exported_ops.push_back(op); // This is a helpful action.
             assert(op->is_applicable(state));
 	}
@@ -501,7 +929,7 @@ bool is_landmark(vector<pair<int, int> >& landmarks, int var, int val) {
 
 int FFHeuristic::plan_for_disj(vector<pair<int, int> >& landmarks, 
 			       const State& state) {
-    relaxed_plan.clear();
+    clear_relaxed_plan();
     // generate plan to reach part of disj. goal OR if no landmarks given, plan to real goal
     if(!landmarks.empty()) {
         // search for quickest achievable landmark leaves
@@ -509,32 +937,31 @@ int FFHeuristic::plan_for_disj(vector<pair<int, int> >& landmarks,
 	    prepare_heuristic_computation(state);
 	}
 	int min_cost = INT_MAX;
-	Proposition *target = NULL;
+	int target = -1;
 	for(int i = 0; i < termination_propositions.size(); i++) {
-	    const int prop_cost = termination_propositions[i]->h_add_cost;
-	    if(prop_cost == -1 && is_landmark(landmarks, termination_propositions[i]->var,
-                                              termination_propositions[i]->val)) { // DEAD_END
+	    int prop = termination_propositions[i];
+	    const int prop_cost = prop_h_add_cost[prop];
+	    if(prop_cost == -1 && is_landmark(landmarks, prop_var[prop], prop_val[prop])) { // DEAD_END
 		return DEAD_END;
 	    }
-	    if(prop_cost < min_cost && is_landmark(landmarks, termination_propositions[i]->var,
-						   termination_propositions[i]->val)) {
-		target = termination_propositions[i];
+	    if(prop_cost < min_cost && is_landmark(landmarks, prop_var[prop], prop_val[prop])) {
+		target = prop;
 		min_cost = prop_cost;
 	    }
 	}
-	assert(target != NULL);
+	assert(target != -1);
 	assert(exported_ops.size() == 0);
-	collect_ha(target, relaxed_plan, state);
+	collect_ha(target, state);
     } else {
         // search for original goals of the task
 	if(heuristic_recomputation_needed) {
 	    prepare_heuristic_computation(state);
 	}   
 	for(int i = 0; i < goal_propositions.size(); i++) {
-	    if(goal_propositions[i]->h_add_cost == -1)
+	    if(prop_h_add_cost[goal_propositions[i]] == -1)
 		return DEAD_END;
-	    collect_ha(goal_propositions[i], relaxed_plan, state);
+	    collect_ha(goal_propositions[i], state);
 	}
     }
-    return relaxed_plan.size();
+    return relaxed_plan_size;
 }
@@ -55,23 +55,10 @@ struct Proposition {
     func_operations func_op;
     float func_val = 0;
     bool is_goal_condition;
-    bool is_termination_condition;
-    std::vector<UnaryOperator *> precondition_of;
-
-    int h_add_cost;
-    int h_max_cost;
-    int depth;
-    bool marked; // used when computing preferred operators
-    UnaryOperator *reached_by;
 
     Proposition() {
 	is_goal_condition = false;
-	is_termination_condition = false;
 	func_op = NO_OPP;
-	h_add_cost = -1;
-	h_max_cost = -1;
-	reached_by = 0;
-	marked = false;
     }
   
     bool operator<(const Proposition &other) const {
@@ -80,19 +67,31 @@ struct Proposition {
   
 };
 
+struct NumericCondition {
+    int var;
+    func_operations op; // GREAT_THAN (var >= value) or LESS_THAN (var <= value)
+    float value;
+    NumericCondition(int v, func_operations o, float val) : var(v), op(o), value(val) {}
+};
+
 struct UnaryOperator {
     const Operator *op;
     std::vector<Proposition *> precondition;
     Proposition *effect;
     int base_cost; // 0 for axioms, 1 for regular operators
 
-    int unsatisfied_preconditions;
-    int h_add_cost;
-    int h_max_cost;
-    int depth;
+    // Numeric conditions of op, and numeric effect of this unary operator
+    std::vector<NumericCondition> numeric_precondition;
+    func_operations numeric_effect; // NO_OPP, INCREASE, DECREASE or ASSIGN
+    int numeric_var;
+    float numeric_amount;
+    bool numeric_amount_known; // false for runtime and module effects
+
     UnaryOperator(const std::vector<Proposition *> &pre, Proposition *eff,
 		  const Operator *the_op, int base)
-	: op(the_op), precondition(pre), effect(eff), base_cost(base) {}
+	: op(the_op), precondition(pre), effect(eff), base_cost(base),
+	  numeric_effect(NO_OPP), numeric_var(-1), numeric_amount(0),
+	  numeric_amount_known(true) {}
 
   
     bool operator<(const UnaryOperator &other) const {
@@ -117,20 +116,143 @@ struct UnaryOperator {
 
 
 class LandmarksCountHeuristic;
+class TemporalHeuristic;
 
 class FFHeuristic : public Heuristic {
     friend class LandmarksCountHeuristic;
+    friend class TemporalHeuristic;
 
-    typedef __gnu_cxx::hash_set<const Operator *, hash_operator_ptr> RelaxedPlan;
-    RelaxedPlan relaxed_plan;
     std::vector<UnaryOperator> unary_operators;
     std::vector<std::vector<Proposition> > propositions;
-    std::vector<Proposition *> goal_propositions;
-    std::vector<Proposition *> termination_propositions;
+    std::vector<int> goal_propositions;        // proposition ids
+    std::vector<int> termination_propositions; // proposition ids
+
+    /* Data used by the relaxed exploration, compiled from propositions and
+       unary_operators into index arrays (propositions are numbered per
+       variable, unary operators by their position in unary_operators).
+       Precondition and trigger lists are stored contiguously (CSR), and
+       the fields updated during exploration in separate dense arrays. */
+    std::vector<int> prop_offset; // id of the first proposition of each variable
+    int get_prop_id(int var, int val) const {return prop_offset[var] + val;}
+    std::vector<int> prop_var;
+    std::vector<int> prop_val;
+    std::vector<char> prop_is_termination;
+    std::vector<int> prop_trigger_begin; // triggers of p: [begin[p], begin[p + 1])
+    std::vector<int> prop_triggers;      // unary operators with p as precondition
+    std::vector<int> prop_all_trigger_begin; // as above, including pruned operators
+    std::vector<int> prop_all_triggers;
+
+    std::vector<int> prop_h_add_cost;
+    std::vector<int> prop_h_max_cost;
+    std::vector<int> prop_depth;
+    std::vector<int> prop_reached_by;    // unary operator, -1 for the state
+    std::vector<char> prop_marked;       // used when computing preferred operators
+    std::vector<int> prop_epoch;         // last exploration that changed the fields above
+
+    std::vector<int> op_pre_begin;       // preconditions of o: [begin[o], begin[o + 1])
+    std::vector<int> op_pre;
+    std::vector<int> op_effect;
+    std::vector<int> op_base_cost;
+    std::vector<char> op_is_axiom;
+    std::vector<int> op_operator_index; // index in g_operators, -1 for axioms
+
+    /* Unary operators that are duplicates of another one (same effect and
+       preconditions) or dominated by one (same effect, a subset of the
+       preconditions, no higher cost) never improve the heuristic and are
+       left out of the triggers. Explorations with excluded operators
+       (landmark generation) still use all of them, since the operator
+       kept for an effect may be the excluded one. */
+    std::vector<char> op_pruned;
+    bool explore_all_operators;
+    void prune_unary_operators();
+
+    /* Interval relaxation of numeric variables: the exploration keeps the
+       bounds [var_lo, var_hi] reachable from the state, and a numeric
+       condition counts as an unsatisfied precondition of its unary
+       operators until the bounds allow it. An applicable increase,
+       decrease or assign widens the bounds of its variable. */
+    std::vector<int> op_num_pre_begin;   // numeric conditions of o: [begin[o], begin[o + 1])
+    std::vector<int> op_num_pre;
+    std::vector<int> cond_var;
+    std::vector<char> cond_greater;      // var >= value, otherwise var <= value
+    std::vector<float> cond_value;
+    std::vector<int> cond_op;
+    std::vector<int> var_cond_begin;     // conditions on var: [begin[var], begin[var + 1])
+    std::vector<int> var_conds;
+    std::vector<char> op_num_effect;     // func_operations of the numeric effect
+    std::vector<int> op_num_var;
+    std::vector<float> op_num_amount;
+    std::vector<char> op_num_amount_known;
 
-    typedef std::vector<Proposition *> Bucket;
+    std::vector<float> var_lo;
+    std::vector<float> var_hi;
+    std::vector<int> cond_epoch;         // exploration in which the condition holds
+    std::vector<int> cond_achiever;      // unary operator satisfying it, -1 in the state
+    std::vector<int> cond_plan_epoch;    // conditions visited by the plan extraction
+    std::vector<int> op_numeric_unsatisfied; // conditions of o not holding in the state
+    std::vector<int> numeric_worklist;
+    bool condition_holds(int cond) const {
+	return cond_greater[cond] ? var_hi[cond_var[cond]] >= cond_value[cond]
+	                          : var_lo[cond_var[cond]] <= cond_value[cond];
+    }
+    void setup_numeric_bounds(const State &state);
+    void apply_unary_operator(int op, int cost, int depth, bool use_h_max);
+    void widen_numeric_bounds(int op, bool use_h_max);
+
+    std::vector<int> op_unsatisfied_preconditions;
+    std::vector<int> op_h_add_cost;
+    std::vector<int> op_h_max_cost;
+    std::vector<int> op_depth;
+    std::vector<int> op_epoch;           // exploration for which the fields above are initialized
+
+    typedef std::vector<int> Bucket;
     std::vector<Bucket> reachable_queue;
 
+    // Explorations only reset the propositions changed by the previous one
+    // and initialize unary operators when they are first triggered.
+    int exploration_epoch;
+    std::vector<int> touched_propositions;
+    std::vector<int> precondition_free_operators;
+    void touch_proposition(int prop) {
+	if(prop_epoch[prop] != exploration_epoch) {
+	    prop_epoch[prop] = exploration_epoch;
+	    touched_propositions.push_back(prop);
+	}
+    }
+    void init_unary_operator(int op) {
+	op_epoch[op] = exploration_epoch;
+	op_unsatisfied_preconditions[op] = op_pre_begin[op + 1] - op_pre_begin[op] +
+	    op_numeric_unsatisfied[op];
+	op_h_add_cost[op] = op_base_cost[op]; // will be increased by precondition costs
+	op_h_max_cost[op] = op_base_cost[op];
+	op_depth[op] = -1;
+    }
+    void compile_exploration_data();
+    void start_exploration();
+
+    /* Relaxed plan extraction: operators in the current relaxed plan are
+       those whose marker equals plan_epoch, so starting a new plan only
+       increments the epoch. Size and cost are accumulated while the plan
+       is extracted (iteratively, with an explicit stack). */
+    int plan_epoch;
+    std::vector<int> operator_plan_epoch; // per operator of g_operators
+    std::vector<int> prop_plan_epoch;     // propositions visited by collect_ha
+    int relaxed_plan_size;
+    int relaxed_plan_cost;
+    struct ExtractionFrame {
+	int unary_op;
+	int next_pre;     // next precondition of unary_op to visit
+	int next_num_pre; // next numeric condition of unary_op to visit
+	ExtractionFrame(int op, int pre, int num_pre)
+	    : unary_op(op), next_pre(pre), next_num_pre(num_pre) {}
+    };
+    ExtractionFrame extraction_frame(int op) const {
+	return ExtractionFrame(op, op_pre_begin[op], op_num_pre_begin[op]);
+    }
+    std::vector<ExtractionFrame> extraction_stack;
+    void clear_relaxed_plan();
+    bool add_to_relaxed_plan(int unary_op);
+
     bool heuristic_recomputation_needed;
 
     void build_unary_operators(const Operator &op);
@@ -140,22 +262,18 @@ class FFHeuristic : public Heuristic {
 				 const __gnu_cxx::hash_set<const Operator *, 
 				 hash_operator_ptr>& excluded_ops,
 				 bool use_h_max);
-    inline void setup_exploration_queue(const State &state, bool h_max) {
-	std::vector<std::pair<int, int> > excluded_props;
-	__gnu_cxx::hash_set<const Operator *, hash_operator_ptr> excluded_ops;
-	setup_exploration_queue(state, excluded_props, excluded_ops, h_max);
-    }
+    void setup_exploration_queue(const State &state, bool h_max);
     void relaxed_exploration(bool use_h_max, bool level_out);
     void prepare_heuristic_computation(const State& state, bool h_max);
-    void collect_relaxed_plan(Proposition *goal, RelaxedPlan &relaxed_plan, const State &state);
+    void collect_relaxed_plan(int goal, const State &state);
 
     int compute_hsp_add_heuristic();
     float compute_hsp_max_heuristic();
     int compute_ff_heuristic(const State &state);
 
-    void collect_ha(Proposition *goal, RelaxedPlan &relaxed_plan, const State &state);
+    void collect_ha(int goal, const State &state);
 
-    void enqueue_if_necessary(Proposition *prop, int cost, int depth, UnaryOperator *op, 
+    void enqueue_if_necessary(int prop, int cost, int depth, int op,
 			      bool use_h_max);
 protected:
     virtual int compute_heuristic(const State &state);
@@ -25,6 +25,7 @@
 #include "globals.h"
 #include "external_function.h"
 
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -32,6 +33,9 @@
 #include <fstream>
 #include <dlfcn.h>
 #include <sstream>      // std::stringstream
+#include <map>
+#include <algorithm>
+#include <thread>
 //#include "utils/system.h"
 using namespace std;
 
@@ -93,8 +97,10 @@ void read_variables(istream &in) {
         g_axiom_layers.push_back(layer);
         int isTotalTime;
         in >> isTotalTime;
-        if(isTotalTime)
+        if(isTotalTime) {
         	total_time_var = name;
+        	g_total_time_var = i;
+        }
     }
     check_magic(in, "end_variables");
 }
@@ -187,6 +193,112 @@ void read_operators(istream &in) {
         g_operators.push_back(Operator(in, false));
 }
 
+void compute_operator_metadata() {
+    // Snap kind, start/end pairing, duration effect, numeric conditions and
+    // shared-var effects, so that the search never has to scan names again.
+    vector<int> shared_order(g_variable_domain.size(), -1);
+    for(int i = 0; i < g_shared_vars.size(); i++)
+	if(g_shared_vars[i].second >= 0 && g_shared_vars[i].second < shared_order.size()
+	   && shared_order[g_shared_vars[i].second] == -1)
+	    shared_order[g_shared_vars[i].second] = i;
+
+    map<string, int> start_ops;
+    for(int i = 0; i < g_operators.size(); i++) {
+	Operator &op = g_operators[i];
+	// Same precedence as the non-temporal name built in Operator(istream&)
+	if(op.name.find("_start") != string::npos)
+	    op.snap = start_snap;
+	else if(op.name.find("_end") != string::npos)
+	    op.snap = end_snap;
+	else
+	    op.snap = no_snap;
+	op.numeric_pre.clear();
+	op.shared_effects.clear();
+	for(int j = 0; j < op.pre_post.size(); j++) {
+	    const PrePost &pp = op.pre_post[j];
+	    if(pp.var == g_total_time_var && op.duration_effect == -1)
+		op.duration_effect = j;
+	    if(pp.pre == -5 || pp.pre == -6)
+		op.numeric_pre.push_back(j);
+	    if(shared_order[pp.var] != -1)
+		op.shared_effects.push_back(j);
+	}
+	// Visit shared effects in the order of the shared-var timelines
+	for(int j = 1; j < op.shared_effects.size(); j++)
+	    for(int k = j; k > 0 && shared_order[op.pre_post[op.shared_effects[k]].var] <
+		    shared_order[op.pre_post[op.shared_effects[k - 1]].var]; k--)
+		swap(op.shared_effects[k], op.shared_effects[k - 1]);
+	if(op.is_start_snap())
+	    start_ops[op.non_temporal_name] = i;
+    }
+    for(int i = 0; i < g_operators.size(); i++) {
+	Operator &op = g_operators[i];
+	if(!op.is_end_snap())
+	    continue;
+	map<string, int>::iterator it = start_ops.find(op.non_temporal_name);
+	if(it != start_ops.end()) {
+	    op.paired_op = it->second;
+	    g_operators[it->second].paired_op = i;
+	}
+    }
+}
+
+static bool runtime_effect_is_static(const string &s_effect, const vector<bool> &is_static) {
+    const vector<int> &vars = get_runtime_effect_vars(s_effect);
+    for(int i = 0; i < vars.size(); i++)
+	if(vars[i] < 0 || vars[i] >= is_static.size() || !is_static[vars[i]])
+	    return false;
+    return true;
+}
+
+void fold_static_runtime_effects() {
+    // A numeric variable is static if no operator changes it, so runtime
+    // effects reading only static variables (or none) are constants.
+    vector<bool> is_static(g_variable_domain.size(), false);
+    for(int var = 0; var < g_variable_domain.size(); var++)
+	is_static[var] = ((*g_initial_state)[var] == -1) && (var != g_total_time_var);
+    for(int i = 0; i < g_operators.size(); i++) {
+	const vector<PrePost> &pre_post = g_operators[i].pre_post;
+	for(int j = 0; j < pre_post.size(); j++)
+	    if(pre_post[j].pre == -2 || pre_post[j].pre == -3 || pre_post[j].pre == -4)
+		is_static[pre_post[j].var] = false;
+    }
+
+    const vector<float> &initial_values = g_initial_state->numeric_vars_val;
+    int folded = 0, dynamic = 0;
+    for(int i = 0; i < g_operators.size(); i++) {
+	Operator &op = g_operators[i];
+	for(int j = 0; j < op.pre_post.size(); j++) {
+	    PrePost &pp = op.pre_post[j];
+	    if(!pp.have_runtime_cost_effect ||
+	       (pp.pre != -2 && pp.pre != -3 && pp.pre != -4))
+		continue;
+	    if(runtime_effect_is_static(pp.runtime_cost_effect, is_static)) {
+		pp.f_cost = evaluate_runtime_effect<float>(pp.runtime_cost_effect, initial_values);
+		pp.have_runtime_cost_effect = false;
+		pp.runtime_cost_effect = "";
+		folded++;
+	    } else {
+		dynamic++;
+	    }
+	}
+	if(op.have_runtime_cost) {
+	    if(runtime_effect_is_static(op.runtime_cost, is_static)) {
+		// Same as the g value computed for runtime costs
+		op.cost = evaluate_runtime_effect<float>(op.runtime_cost, initial_values) + 1;
+		op.have_runtime_cost = false;
+		op.runtime_cost = "";
+		folded++;
+	    } else {
+		dynamic++;
+	    }
+	}
+    }
+    if(folded + dynamic > 0)
+	cout << "Folded " << folded << " of " << folded + dynamic
+	     << " runtime effects and costs to constants" << endl;
+}
+
 void read_axioms(istream &in) {
     int count;
     in >> count;
@@ -197,14 +309,42 @@ void read_axioms(istream &in) {
     g_axiom_evaluator->evaluate(*g_initial_state);
 }
 
+// Threads for the parallel parts of the planner, at most g_max_threads
+int get_num_threads() {
+    int num_threads = thread::hardware_concurrency();
+    return max(1, min(num_threads, g_max_threads));
+}
+
+// Graph generated for the same task in an earlier launch, see LandmarksGraph.
+// The fingerprint is part of the name, so that the graphs of different tasks
+// (or options) run from the same directory do not replace each other. Files
+// are never removed by the planner: each distinct task, e.g. each initial
+// state read with the "s" option, adds one. They can be deleted at any time,
+// and MALAMA_LANDMARKS_CACHE=0 disables the cache.
+static string landmarks_cache_filename(unsigned long long fingerprint) {
+    char filename[64];
+    snprintf(filename, sizeof(filename), "landmarks_graph.%016llx.cache", fingerprint);
+    return filename;
+}
+
 void build_landmarks_graph(bool reasonable_orders) {
 	/* The operators are iondexed by its propositions as preconditions and effects */
     g_lgraph = new LandmarksGraphNew();
-    g_lgraph->read_external_inconsistencies();
-    if(reasonable_orders) {
-	g_lgraph->use_reasonable_orders();
+    unsigned long long fingerprint = LandmarksGraph::task_fingerprint(reasonable_orders);
+    string cache_filename = landmarks_cache_filename(fingerprint);
+    if(g_use_landmarks_cache && g_lgraph->read_cache(cache_filename.c_str(), fingerprint)) {
+	cout << "Read landmarks graph from " << cache_filename << endl;
+    } else {
+	if(!g_ff_heur)
+	    g_ff_heur = new FFHeuristic;
+	g_lgraph->read_external_inconsistencies();
+	if(reasonable_orders) {
+	    g_lgraph->use_reasonable_orders();
+	}
+	g_lgraph->generate();
+	if(g_use_landmarks_cache)
+	    g_lgraph->write_cache(cache_filename.c_str(), fingerprint);
     }
-    g_lgraph->generate();
     cout << "Generated " << g_lgraph->number_of_landmarks() << " landmarks, of which "
 	 << g_lgraph->number_of_disj_landmarks() << " are disjunctive" << endl
 	 << "          " << g_lgraph->number_of_edges() << " edges\n";
@@ -229,6 +369,9 @@ void read_everything(istream &in, bool generate_landmarks, bool reasonable_order
     read_timed_goals(in);
     read_modules(in);
     read_operators(in);
+    compute_operator_metadata();
+    fold_static_runtime_effects();
+    compile_runtime_effects();
     read_axioms(in);
 
     if((g_n_metric.size() == 1)) {
@@ -241,11 +384,8 @@ void read_everything(istream &in, bool generate_landmarks, bool reasonable_order
     g_successor_generator = read_successor_generator(in);
     check_magic(in, "end_SG");
     DomainTransitionGraph::read_all(in);
-    if(generate_landmarks){
-	if(!g_ff_heur)
-	    g_ff_heur = new FFHeuristic;
+    if(generate_landmarks)
 	build_landmarks_graph(reasonable_orders);
-    }
     g_initial_state->set_landmarks_for_initial_state();
 }
 
@@ -294,7 +434,32 @@ void load_external_modules()
 		}
 		g_ext_func_manager.load_module(*it_mod);
 	}
+	resolve_external_functions();
+}
 
+static int resolve_external_function(const string &func_name) {
+    unordered_map<string, int>::const_iterator it = g_instantiated_funcs_dict.find(func_name);
+    int index = -1;
+    if(it != g_instantiated_funcs_dict.end())
+	index = g_ext_func_manager.get_function_index(it->second);
+    if(index == -1) {
+	cout << "No external function loaded for: " << func_name << endl;
+	exit(1);
+    }
+    return index;
+}
+
+void resolve_external_functions() {
+    // Module costs are looked up by name only once, evaluation then goes
+    // straight to the function table of the manager.
+    for(int i = 0; i < g_operators.size(); i++) {
+	Operator &op = g_operators[i];
+	for(int j = 0; j < op.pre_post.size(); j++)
+	    if(op.pre_post[j].have_module_cost_effect)
+		op.pre_post[j].ext_func = resolve_external_function(op.pre_post[j].runtime_cost_effect);
+	if(op.have_module_cost)
+	    op.runtime_cost_func = resolve_external_function(op.runtime_cost);
+    }
 }
 
 void dump_everything() {
@@ -442,21 +607,38 @@ void read_runtime_contraints()
 	process_shared_vars_values();
 }
 
+int SharedVarTimeline::find_window(float time) const {
+	// Window j such that times[j] < time <= times[j + 1], -1 if there is none
+	vector<float>::const_iterator it = lower_bound(times.begin(), times.end(), time);
+	if((it == times.begin()) || (it == times.end()))
+		return -1;
+	return (it - times.begin()) - 1;
+}
+
+const SharedVarTimeline *get_shared_var_timeline(int var) {
+	if((var < 0) || (var >= g_shared_var_timeline_index.size()))
+		return NULL;
+	int index = g_shared_var_timeline_index[var];
+	return (index == -1) ? NULL : &g_shared_vars_timelines[index];
+}
+
 void process_shared_vars_values()
 {
+	g_shared_vars_timelines.clear();
+	g_shared_var_timeline_index.assign(g_variable_domain.size(), -1);
 	for(int i = 0; i < g_shared_vars.size(); i ++)
 	{
-		pair<int, vector<pair<int, float>* >* >* shared_var_pair_list = new pair<int, vector<pair<int, float>* >* >();
+		g_shared_vars_timelines.push_back(SharedVarTimeline());
+		SharedVarTimeline &timeline = g_shared_vars_timelines.back();
+		timeline.var = g_shared_vars[i].second;
+		if((timeline.var >= 0) && (timeline.var < g_shared_var_timeline_index.size()) &&
+				(g_shared_var_timeline_index[timeline.var] == -1))
+			g_shared_var_timeline_index[timeline.var] = i;
 
-		shared_var_pair_list->first = g_shared_vars[i].second;
-
-		vector<pair<int, float>* > *var_timed_values = new vector<pair<int, float>* >();
-
-		pair<int, float> *first_value = new pair<int, float>();
-		first_value->first = int(-1);
-		first_value->second = float(0.00);
-		var_timed_values->push_back(first_value);
+		timeline.values.push_back(-1);
+		timeline.times.push_back(0.00);
 
+		// Constraints are added in increasing time order, so times stays sorted
 		int min_index = -1;
 		float curr_time_value = 0;
 		bool min_found = false;
@@ -481,32 +663,23 @@ void process_shared_vars_values()
 				if(last_added_val != external_blocked_vars[min_index]->val_pos)
 				{
 					last_added_val = external_blocked_vars[min_index]->val_pos;
-					pair<int, float> *timed_value = new pair<int, float>();
-					timed_value->first = external_blocked_vars[min_index]->val_pos;
-					timed_value->second = external_blocked_vars[min_index]->time_set;
-
-					var_timed_values->push_back(timed_value);
-					curr_time_value = external_blocked_vars[min_index]->time_set;
-				}else{
-					curr_time_value = external_blocked_vars[min_index]->time_set;
+					timeline.values.push_back(external_blocked_vars[min_index]->val_pos);
+					timeline.times.push_back(external_blocked_vars[min_index]->time_set);
 				}
+				curr_time_value = external_blocked_vars[min_index]->time_set;
 			}
 
 		} while(min_found);
-
-
-		shared_var_pair_list->second = var_timed_values;
-		g_shared_vars_timed_values.push_back(shared_var_pair_list);
 	}
 
 
-	for(int k = 0; k < g_shared_vars_timed_values.size(); k++)
+	for(int k = 0; k < g_shared_vars_timelines.size(); k++)
 	{
-		cout << "States for shared var: " <<  g_shared_vars_timed_values[k]->first << endl;
-		for(int j = 0; j < g_shared_vars_timed_values[k]->second->size(); j++)
+		cout << "States for shared var: " <<  g_shared_vars_timelines[k].var << endl;
+		for(int j = 0; j < g_shared_vars_timelines[k].times.size(); j++)
 		{
-			cout << "--- " << (*(g_shared_vars_timed_values[k]->second))[j]->first <<
-					" // " << (*(g_shared_vars_timed_values[k]->second))[j]->second << endl;
+			cout << "--- " << g_shared_vars_timelines[k].values[j] <<
+					" // " << g_shared_vars_timelines[k].times[j] << endl;
 		}
 	}
 }
@@ -620,6 +793,7 @@ vector<string> g_variable_name;
 vector<int> g_variable_domain;
 vector<int> g_axiom_layers;
 string total_time_var;
+int g_total_time_var = -1;
 vector<int> g_default_axiom_values;
 State *g_initial_state;
 vector<ext_constraint*> external_blocked_vars;
@@ -629,7 +803,8 @@ vector<ExternalFunctionModuleInfo> g_modules;
 std::unordered_map<string, int> g_instantiated_funcs_dict;
 ExternalFunctionManager g_ext_func_manager;
 vector<pair<string, int> > g_shared_vars;
-vector<pair<int, vector<pair<int, float>* >* >* > g_shared_vars_timed_values;
+vector<SharedVarTimeline> g_shared_vars_timelines;
+vector<int> g_shared_var_timeline_index;
 vector<pair<string, int> > external_init_state_vars;
 vector<pair<string, float> > external_init_state_numeric_vars;
 vector<Operator> g_operators;
@@ -644,3 +819,5 @@ int g_cache_hits = 0, g_cache_misses = 0;
 FFHeuristic *g_ff_heur;
 LandmarksCountHeuristic *g_lm_heur;
 LandmarksGraph *g_lgraph;
+int g_max_threads = 16; // set from MALAMA_THREADS by the planner
+bool g_use_landmarks_cache = true; // unset by MALAMA_LANDMARKS_CACHE=0
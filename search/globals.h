@@ -46,11 +46,15 @@ class LandmarksGraph;
 
 void read_everything(istream &in, bool generate_landmarks, bool reasonable_orders, bool read_init_state, bool read_runtime_constraints);
 void load_external_modules();
+void resolve_external_functions();
 void read_runtime_contraints();
 void process_shared_vars_values();
 void read_ext_init_state();
 void read_store_ext_init_state();
+void compute_operator_metadata();
+void fold_static_runtime_effects();
 void dump_everything();
+int get_num_threads();
 
 void check_magic(istream &in, string magic);
 
@@ -70,6 +74,18 @@ typedef struct{
 	bool in_current_agent;
 } ext_constraint;
 
+// Values imposed on a shared variable by external constraints: the value
+// is values[j] from times[j] to times[j + 1] (-1 if unconstrained), and
+// the last value holds from times.back() on.
+struct SharedVarTimeline {
+	int var;
+	vector<float> times;
+	vector<int> values;
+	int find_window(float time) const;
+};
+
+const SharedVarTimeline *get_shared_var_timeline(int var);
+
 extern bool g_use_metric;
 extern bool g_length_metric;
 extern bool g_use_metric_total_time;
@@ -80,6 +96,7 @@ extern vector<int> g_variable_domain;
 extern vector<int> g_axiom_layers;
 extern vector<int> g_default_axiom_values;
 extern string total_time_var;
+extern int g_total_time_var;
 extern vector<ext_constraint*> external_blocked_vars;
 extern vector<pair<string, int> > external_init_state_vars;
 extern vector<pair<string, float> > external_init_state_numeric_vars;
@@ -91,7 +108,8 @@ extern vector<ExternalFunctionModuleInfo> g_modules;
 extern std::unordered_map<string, int> g_instantiated_funcs_dict;
 extern ExternalFunctionManager g_ext_func_manager;
 extern vector<pair<string, int> > g_shared_vars;
-extern vector<pair<int, vector<pair<int, float>* >* >* > g_shared_vars_timed_values;
+extern vector<SharedVarTimeline> g_shared_vars_timelines;
+extern vector<int> g_shared_var_timeline_index;
 extern vector<Operator> g_operators;
 extern vector<Operator> g_axioms;
 extern AxiomEvaluator *g_axiom_evaluator;
@@ -106,5 +124,7 @@ extern LandmarksCountHeuristic *g_lm_heur;
 extern LandmarksGraph *g_lgraph;
 extern bool is_temporal;
 extern bool use_hard_temporal_constraints;
+extern int g_max_threads;
+extern bool g_use_landmarks_cache;
 
 #endif
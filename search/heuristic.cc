@@ -22,18 +22,26 @@
  *********************************************************************/
 
 #include "heuristic.h"
-#include "state.h"
-
-#ifndef NDEBUG
+#include "globals.h"
 #include "operator.h"
-#endif
+#include "state.h"
 
 #include <cassert>
 using namespace std;
 
-Heuristic::Heuristic(bool use_caching) {
-    use_cache = use_caching;
+Heuristic::Heuristic(bool use_caching, int capacity) {
+    use_cache = use_caching && capacity > 0;
     heuristic = INVALID;
+    cache_capacity = capacity;
+    cache_size = 0;
+    clock_hand = 0;
+    preferred_garbage = 0;
+    if(use_cache) {
+	int num_slots = 1;
+	while(num_slots < 2 * cache_capacity)
+	    num_slots *= 2;
+	cache_slots.resize(num_slots);
+    }
 }
 
 Heuristic::~Heuristic() {
@@ -43,13 +51,102 @@ void Heuristic::set_preferred(const Operator *op) {
     preferred_operators.push_back(op);
 }
 
+int Heuristic::find_cache_slot(unsigned long long key) const {
+    // Slot holding key, or the empty slot where it would be inserted
+    int mask = cache_slots.size() - 1;
+    int slot = key & mask;
+    while(cache_slots[slot].used && cache_slots[slot].key != key)
+	slot = (slot + 1) & mask;
+    return slot;
+}
+
+void Heuristic::erase_cache_slot(int slot) {
+    // Backward shift deletion keeps the probe sequences intact
+    int mask = cache_slots.size() - 1;
+    preferred_garbage += cache_slots[slot].preferred_count;
+    int hole = slot;
+    for(int next = (hole + 1) & mask; cache_slots[next].used; next = (next + 1) & mask) {
+	int home = cache_slots[next].key & mask;
+	bool movable = hole <= next ? (home <= hole || home > next)
+	                            : (home <= hole && home > next);
+	if(movable) {
+	    cache_slots[hole] = cache_slots[next];
+	    hole = next;
+	}
+    }
+    cache_slots[hole] = CacheEntry();
+    cache_size--;
+}
+
+void Heuristic::evict_cache_entry() {
+    int mask = cache_slots.size() - 1;
+    for(;;) {
+	CacheEntry &entry = cache_slots[clock_hand];
+	if(entry.used) {
+	    if(!entry.referenced) {
+		erase_cache_slot(clock_hand);
+		return;
+	    }
+	    entry.referenced = false;
+	}
+	clock_hand = (clock_hand + 1) & mask;
+    }
+}
+
+void Heuristic::compact_preferred_pool() {
+    vector<int> pool;
+    pool.reserve(preferred_pool.size() - preferred_garbage);
+    for(int i = 0; i < cache_slots.size(); i++) {
+	CacheEntry &entry = cache_slots[i];
+	if(!entry.used)
+	    continue;
+	int begin = pool.size();
+	pool.insert(pool.end(), preferred_pool.begin() + entry.preferred_begin,
+		    preferred_pool.begin() + entry.preferred_begin + entry.preferred_count);
+	entry.preferred_begin = begin;
+    }
+    preferred_pool.swap(pool);
+    preferred_garbage = 0;
+}
+
+void Heuristic::insert_cache_entry(unsigned long long key) {
+    if(cache_size >= cache_capacity)
+	evict_cache_entry();
+    if(preferred_garbage > 1024 && 2 * preferred_garbage > preferred_pool.size())
+	compact_preferred_pool();
+    CacheEntry &entry = cache_slots[find_cache_slot(key)];
+    entry.key = key;
+    entry.heuristic = heuristic;
+    entry.preferred_begin = preferred_pool.size();
+    entry.preferred_count = preferred_operators.size();
+    entry.used = true;
+    entry.referenced = false;
+    for(int i = 0; i < preferred_operators.size(); i++)
+	preferred_pool.push_back(preferred_operators[i] - &g_operators[0]);
+    cache_size++;
+}
+
+unsigned long long Heuristic::cache_key(const State &state) const {
+    return state.get_hash();
+}
+
 void Heuristic::evaluate(const State &state) {
+    unsigned long long key = 0;
     if(use_cache) {
-	map<State, EvaluationInfo>::iterator it =
-	    state_cache.find(state);
-	if(it != state_cache.end()) {
-	    heuristic = it->second.heuristic;
-	    preferred_operators = it->second.preferred_operators;
+	key = cache_key(state);
+	CacheEntry &entry = cache_slots[find_cache_slot(key)];
+	if(entry.used) {
+	    // A hit is accepted on hash equality alone, see CacheEntry
+	    entry.referenced = true;
+	    heuristic = entry.heuristic;
+	    preferred_operators.clear();
+	    for(int i = 0; i < entry.preferred_count; i++)
+		preferred_operators.push_back(&g_operators[preferred_pool[entry.preferred_begin + i]]);
+#ifndef NDEBUG
+	    // A collision would most likely hand out operators of another state
+	    for(int i = 0; i < preferred_operators.size(); i++)
+		assert(preferred_operators[i]->is_applicable(state));
+#endif
 	    return;
 	}
     }
@@ -66,10 +163,8 @@ void Heuristic::evaluate(const State &state) {
 	preferred_operators.clear();
     }
 
-    if(use_cache) {
-	EvaluationInfo info(heuristic, preferred_operators);
-	state_cache[state] = info;
-    }
+    if(use_cache)
+	insert_cache_entry(key);
 
 #ifndef NDEBUG
     if(heuristic != DEAD_END) {
@@ -24,7 +24,6 @@
 #ifndef HEURISTIC_H
 #define HEURISTIC_H
 
-#include <map>
 #include <vector>
 
 class Operator;
@@ -37,22 +36,49 @@ class Heuristic {
     int heuristic;
     std::vector<const Operator *> preferred_operators;
 
-    struct EvaluationInfo {
-	EvaluationInfo() {heuristic = INVALID;}
-	EvaluationInfo(int heur, const std::vector<const Operator *> &pref)
-	    : heuristic(heur), preferred_operators(pref) {}
+    /* Bounded cache of evaluations, keyed by the 64-bit hash of the state
+       (cache_key, State::get_hash by default). Open addressing with
+       linear probing, evicting with the CLOCK algorithm once capacity
+       entries are stored. The preferred operators of an entry are a span
+       of operator indices in preferred_pool, which is compacted when half
+       of it is garbage.
+       States are not stored, so two states with the same hash share an
+       entry: with 64-bit hashes a collision is assumed not to happen
+       within the capacity of the cache. Debug builds check that the
+       preferred operators of a hit are applicable in the state. */
+    struct CacheEntry {
+	unsigned long long key;
 	int heuristic;
-	std::vector<const Operator *> preferred_operators;
+	int preferred_begin;
+	int preferred_count;
+	bool used;
+	bool referenced;
+	CacheEntry() : key(0), heuristic(INVALID), preferred_begin(0),
+		       preferred_count(0), used(false), referenced(false) {}
     };
 
     bool use_cache;
-    std::map<State, EvaluationInfo> state_cache;
+    int cache_capacity;
+    int cache_size;
+    int clock_hand;
+    std::vector<CacheEntry> cache_slots; // power of two, at least twice the capacity
+    std::vector<int> preferred_pool;
+    int preferred_garbage;
+
+    int find_cache_slot(unsigned long long key) const;
+    void evict_cache_entry();
+    void erase_cache_slot(int slot);
+    void compact_preferred_pool();
+    void insert_cache_entry(unsigned long long key);
 protected:
     enum {DEAD_END = -1};
     virtual int compute_heuristic(const State &state) = 0;
+    // Key of the cache, must cover everything compute_heuristic reads
+    virtual unsigned long long cache_key(const State &state) const;
     void set_preferred(const Operator *op);
 public:
-    Heuristic(bool use_cache=false);
+    enum {DEFAULT_CACHE_CAPACITY = 1 << 16};
+    Heuristic(bool use_cache=false, int cache_capacity=DEFAULT_CACHE_CAPACITY);
     virtual ~Heuristic();
 
     void evaluate(const State &state);
@@ -52,26 +52,29 @@ void LandmarksCountHeuristic::set_recompute_heuristic(const State &state) {
         assert(ff_heuristic != 0);
         // Set additional goals for FF exploration
         vector<pair<int, int> > lm_leaves;
-        hash_set<const LandmarkNode*, hash_pointer> result;
-        state.check_partial_plan(result);
-        collect_lm_leaves(ff_search_disjunctive_lms, result, lm_leaves);
+        collect_lm_leaves(ff_search_disjunctive_lms, state, lm_leaves);
         ff_heuristic->set_additional_goals(lm_leaves);
     }
 }
 
 int LandmarksCountHeuristic::compute_heuristic(const State &state) {
-    // Get landmarks that have been true at some point (put into 
-    // "reached_lms") and their cost
-    hash_set<const LandmarkNode*, hash_pointer> reached_lms;
-    const int reached_lms_cost = state.check_partial_plan(reached_lms);
-    // Get landmarks that are needed again (of those in 
-    // "reached_lms") because they have been made false in the meantime, 
-    // but are goals or required by unachieved successors
+    // Landmarks that have been true at some point ("reached_lms") and 
+    // their cost, maintained by the state as it is generated
+    const hash_set<const LandmarkNode*, hash_pointer>& reached_lms = state.get_reached_lms();
+    const int reached_lms_cost = state.get_reached_lms_cost();
+    // Landmarks that are needed again (of those in "reached_lms") 
+    // because they have been made false in the meantime, but are goals
+    // or required by unachieved successors
+    const int needed_lms_cost = state.get_needed_lms_cost();
+    const int needed_lms_count = state.get_needed_lms_count();
+#ifndef NDEBUG
     hash_set<const LandmarkNode*, hash_pointer> needed_lms;
-    const int needed_lms_cost = state.get_needed_landmarks(needed_lms);
+    assert(state.get_needed_landmarks(needed_lms) == needed_lms_cost);
+    assert(needed_lms.size() == needed_lms_count);
+#endif
     assert(0 <= needed_lms_cost);
     assert(reached_lms_cost >= needed_lms_cost);
-    assert(reached_lms.size() >= needed_lms.size());
+    assert(reached_lms.size() >= needed_lms_count);
 
     // Heuristic is total number (or cost, if action costs are used) of landmarks, 
     // minus the ones we have already achieved and do not need again
@@ -79,17 +82,14 @@ int LandmarksCountHeuristic::compute_heuristic(const State &state) {
     if(g_use_metric)
 	h = lgraph.cost_of_landmarks() - reached_lms_cost + needed_lms_cost;
     else
-	h = lgraph.number_of_landmarks() - reached_lms.size() + needed_lms.size();
+	h = lgraph.number_of_landmarks() - reached_lms.size() + needed_lms_count;
     assert(h >= 0);
 
     // Test if goal has been reached even though the landmark heuristic is 
     // not 0. This may happen if landmarks are achieved before their parents 
     // in the landmarks graph, because they do not get counted as reached 
     // in that case. However, we must return 0 for a goal state.
-    bool goal_reached = true;
-    for(int i = 0; i < g_goal.size(); i++)
-	if(state[g_goal[i].first] != g_goal[i].second)
-	    goal_reached = false;
+    bool goal_reached = state.get_missing_goals() == 0;
     if(goal_reached && h !=0) {
         cout << "Goal reached but Landmark heuristic != 0" << endl;
 	/*
@@ -134,8 +134,7 @@ int LandmarksCountHeuristic::compute_heuristic(const State &state) {
 
 	assert(ff_heuristic != NULL);
 	// Use FF to plan to a landmark leaf
-	int dead_end = ff_search_lm_leaves(ff_search_disjunctive_lms, 
-					   state, reached_lms);
+	int dead_end = ff_search_lm_leaves(ff_search_disjunctive_lms, state);
 	if(dead_end) {
             assert(dead_end == DEAD_END);
             ff_heuristic->exported_ops.clear();
@@ -150,35 +149,31 @@ int LandmarksCountHeuristic::compute_heuristic(const State &state) {
 }
 
 void LandmarksCountHeuristic::
-collect_lm_leaves(bool disjunctive_lms,
-		  hash_set<const LandmarkNode*,hash_pointer>& reached_lms,
+collect_lm_leaves(bool disjunctive_lms, const State& state,
 		  vector<pair<int, int> >& leaves) {
 
-    set<LandmarkNode*>::const_iterator it;
-    for(it = lgraph.get_nodes().begin(); it != lgraph.get_nodes().end(); it++) {
-        LandmarkNode* node_p = *it;
+    // Unreached landmarks whose parents are all reached, in node order
+    const set<const LandmarkNode*>& lm_leaves = state.get_landmark_leaves();
+    set<const LandmarkNode*>::const_iterator it;
+    for(it = lm_leaves.begin(); it != lm_leaves.end(); it++) {
+        const LandmarkNode* node_p = *it;
     
         if(!disjunctive_lms && node_p->disjunctive )
             continue;
 
-        if(reached_lms.find(node_p) == reached_lms.end() && 
-	   !check_node_orders_disobeyed(*node_p, reached_lms)) {
-
-            for(int i = 0; i < node_p->vars.size(); i++) { 
-                pair<int, int> node_prop = make_pair(node_p->vars[i], 
-						     node_p->vals[i]);
-                leaves.push_back(node_prop);
-            }
+        for(int i = 0; i < node_p->vars.size(); i++) { 
+            pair<int, int> node_prop = make_pair(node_p->vars[i], 
+                                                 node_p->vals[i]);
+            leaves.push_back(node_prop);
         }
     }
 }
 
 int LandmarksCountHeuristic::
-ff_search_lm_leaves(bool disjunctive_lms, const State& state,
-		    hash_set<const LandmarkNode*, hash_pointer>& reached_lms) {
+ff_search_lm_leaves(bool disjunctive_lms, const State& state) {
 
     vector<pair<int, int> > leaves; 
-    collect_lm_leaves(disjunctive_lms, reached_lms, leaves);
+    collect_lm_leaves(disjunctive_lms, state, leaves);
     if(ff_heuristic->plan_for_disj(leaves, state) == DEAD_END) {
         return DEAD_END;
     }
@@ -258,10 +253,9 @@ landmark_is_interesting(const State& s,
        reached before, the LM is a goal, and it's not true at moment */
 
     if(lgraph.number_of_landmarks() != reached.size()) { 
-	if(reached.find(&lm) != reached.end())
-	    return false;
-	else
-            return !check_node_orders_disobeyed(lm, reached);
+	// Unreached with all parents reached
+	const set<const LandmarkNode*>& leaves = s.get_landmark_leaves();
+	return leaves.find(&lm) != leaves.end();
     }
     return lm.is_goal() && !lm.is_true_in_state(s);
 }
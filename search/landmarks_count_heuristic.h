@@ -41,11 +41,9 @@ class LandmarksCountHeuristic : public Heuristic {
     lm_set goal;
     hash_set<const LandmarkNode*, hash_pointer> initial_state_landmarks;
 
-    void collect_lm_leaves(bool disjunctive_lms,
-			   hash_set<const LandmarkNode*,hash_pointer>& result,
+    void collect_lm_leaves(bool disjunctive_lms, const State& state,
 			   vector<pair<int, int> >& leaves);
-    int ff_search_lm_leaves(bool disjunctive_lms, const State& state,
-			    hash_set<const LandmarkNode*, hash_pointer>& result);
+    int ff_search_lm_leaves(bool disjunctive_lms, const State& state);
   
     bool check_node_orders_disobeyed(const LandmarkNode& node, 
 				     const hash_set<const LandmarkNode*, 
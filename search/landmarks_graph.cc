@@ -30,7 +30,15 @@
 #include <fstream>
 #include <sstream>
 #include <climits>
+#include <functional>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #define GetCurrentDir getcwd
 
 #include "landmarks_graph.h"
@@ -61,8 +69,15 @@ static inline bool _operator_eff_includes_non_conditional(const Operator& o,
 
 LandmarksGraph::LandmarksGraph() : landmarks_count(0),
 				   use_external_inconsistencies(false),
-				   reasonable_orders(false) {
+				   reasonable_orders(false),
+				   num_facts(0) {
     generate_operators_lookups();
+    fact_offset.resize(g_variable_name.size());
+    for(int var = 0; var < g_variable_name.size(); var++) {
+        fact_offset[var] = num_facts;
+        num_facts += max(g_variable_domain[var], 0);
+    }
+    fact_row_words = (num_facts + 63) / 64;
 }
 
 bool LandmarksGraph::simple_landmark_exists(const pair<int, int>& lm) const {
@@ -159,13 +174,28 @@ void LandmarksGraph::generate() {
     //cout << "generating landmarks" << endl;
     generate_landmarks();
     if(reasonable_orders) {
+        compute_interference_rows();
         cout << "approx. reasonable orders" << endl;
         approximate_reasonable_orders(false);
         cout << "approx. obedient reasonable orders" << endl;
         approximate_reasonable_orders(true);
+        interference_row_index.clear();
+        vector<unsigned long long>().swap(interference_rows);
     }
     mk_acyclic_graph();
     landmarks_cost = calculate_lms_cost();
+    build_fact_index();
+}
+
+void LandmarksGraph::build_fact_index() {
+    nodes_by_fact.assign(g_variable_domain.size(), vector<vector<const LandmarkNode*> >());
+    for(int var = 0; var < g_variable_domain.size(); var++)
+        nodes_by_fact[var].resize(g_variable_domain[var]);
+    for(set<LandmarkNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+        const LandmarkNode* node = *it;
+        for(int i = 0; i < node->vars.size(); i++)
+            nodes_by_fact[node->vars[i]][node->vals[i]].push_back(node);
+    }
 }
 
 
@@ -192,12 +222,8 @@ void LandmarksGraph::read_external_inconsistencies() {
             int number2 = atoi(number.c_str());
             variable_index.insert(make_pair(number2, i));
         }
-        for(int j = 0; j < g_variable_name.size(); j++) {
-            inconsistent_facts.push_back(vector<set<pair<int, int> > >());
-            for(int k = 0; k < g_variable_domain[j]; k++)
-                inconsistent_facts[j].push_back(set<pair<int, int> >());
-        }
-
+        group_begin.clear();
+        group_facts.clear();
         for(int i = 0; i < no_groups; i++) {
             check_magic(in, "group");
             int no_facts;
@@ -231,6 +257,7 @@ void LandmarksGraph::read_external_inconsistencies() {
 		// Variable may not be in index if it has been discarded by preprocessor
                 if(variable_index.find(var) != variable_index.end()) {
                     pair<int, int> var_val_pair = make_pair(variable_index.find(var)->second, val);
+                    assert(val >= 0 && val < g_variable_domain[var_val_pair.first]);
                     invariant_group.push_back(var_val_pair);
 		    // Save fact with predicate name (needed for disj. LMs / 1-step lookahead)
                     Pddl_proposition prop;
@@ -242,16 +269,27 @@ void LandmarksGraph::read_external_inconsistencies() {
                     }
                 }
             }
-            for(int j = 0; j < invariant_group.size(); j++) {
-                for(int k = 0; k < invariant_group.size(); k++) {
-                    if(j == k)
-                        continue;
-                    inconsistent_facts[invariant_group[j].first][invariant_group[j].second].insert
-                        (make_pair(invariant_group[k].first, invariant_group[k].second));
-                }
+            if(invariant_group.size() > 1) {
+                group_begin.push_back(group_facts.size());
+                for(int j = 0; j < invariant_group.size(); j++)
+                    group_facts.push_back(fact_id(invariant_group[j]));
             }
         }
         check_magic(in, "end_groups");
+        int num_groups = group_begin.size();
+        group_begin.push_back(group_facts.size());
+
+        // Invert the groups, visiting them in order keeps each list sorted
+        fact_group_begin.assign(num_facts + 1, 0);
+        for(int i = 0; i < group_facts.size(); i++)
+            fact_group_begin[group_facts[i] + 1]++;
+        for(int fact = 0; fact < num_facts; fact++)
+            fact_group_begin[fact + 1] += fact_group_begin[fact];
+        fact_groups.resize(group_facts.size());
+        vector<int> next_group(fact_group_begin.begin(), fact_group_begin.end() - 1);
+        for(int group = 0; group < num_groups; group++)
+            for(int i = group_begin[group]; i < group_begin[group + 1]; i++)
+                fact_groups[next_group[group_facts[i]]++] = group;
         myfile.close();
 	use_external_inconsistencies = true;
 /*
@@ -276,7 +314,8 @@ bool LandmarksGraph::relaxed_task_solvable(vector<vector<int> >& lvl_var,
 					   hash_int_pair> >& lvl_op, 
 					   bool level_out,
 					   const LandmarkNode* exclude,
-					   bool compute_lvl_op) const {
+					   bool compute_lvl_op,
+					   FFHeuristic* explorer) const {
 /* Test whether the relaxed planning task is solvable without achieving the propositions in
    "exclude" (do not apply operators that would add a proposition from "exclude").
    As a side effect, collect in lvl_var and lvl_op the earliest possible point in time
@@ -310,8 +349,10 @@ bool LandmarksGraph::relaxed_task_solvable(vector<vector<int> >& lvl_var,
 	    exclude_props.push_back(make_pair(exclude->vars[i], exclude->vals[i]));
     }
     // Do relaxed exploration in ff_heuristic class
-    g_ff_heur->compute_reachability_with_excludes(lvl_var, lvl_op, level_out, exclude_props, exclude_ops,
-						  compute_lvl_op);
+    if(explorer == NULL)
+	explorer = g_ff_heur;
+    explorer->compute_reachability_with_excludes(lvl_var, lvl_op, level_out, exclude_props, exclude_ops,
+						 compute_lvl_op);
     
     // Test whether all goal propositions have a level of less than INT_MAX
     for(int i = 0; i < g_goal.size(); i++)
@@ -473,37 +514,55 @@ bool LandmarksGraph::effect_always_happens(const vector<PrePost>& prepost,
     return eff.empty();
 }
 
+bool LandmarksGraph::in_mutex_group(const pair<int, int>& a, const pair<int, int>& b) const {
+    // Look for a common group in the two sorted group lists
+    int fact_a = fact_id(a), fact_b = fact_id(b);
+    int i = fact_group_begin[fact_a], end_a = fact_group_begin[fact_a + 1];
+    int j = fact_group_begin[fact_b], end_b = fact_group_begin[fact_b + 1];
+    while(i < end_a && j < end_b) {
+        if(fact_groups[i] == fact_groups[j])
+            return true;
+        if(fact_groups[i] < fact_groups[j])
+            i++;
+        else
+            j++;
+    }
+    return false;
+}
+
 inline bool LandmarksGraph::inconsistent(const pair<int,int>& a, 
 					 const pair<int,int>& b) const {
     assert(a.first != b.first || a.second != b.second);
     if(a.first == b.first && a.second != b.second)
         return true;
-    if(use_external_inconsistencies &&
-       inconsistent_facts[a.first][a.second].find(b) != inconsistent_facts[a.first][a.second].end()) 
+    if(use_external_inconsistencies && in_mutex_group(a, b))
         return true;
     return false;
 }
 
-bool LandmarksGraph::interferes(const LandmarkNode* node_a, const LandmarkNode* node_b) const {
-/* Facts a and b interfere (i.e., achieving b before a would mean having to delete b 
-   and re-achieve it in order to achieve a) if one of the following condition holds:
-   1. a and b are inconsistent
-   2. All actions that add a also add e, and e and b are inconsistent
-   3. There is a greedy necessary predecessor x of a, and x and b are inconsistent
-   This is the definition of Hoffmann et al. except that they have one more condition: 
-   "all actions that add a delete b". However, in our case (SAS+ formalism), this condition
-   is the same as 2.
-*/
-    assert(!node_a->disjunctive && ! node_b->disjunctive);
-    pair<int, int> a = make_pair(node_a->vars[0], node_a->vals[0]);
-    pair<int, int> b = make_pair(node_b->vars[0], node_b->vals[0]);
-    assert(a.first != b.first || a.second != b.second);
-
-    // 1. a, b inconsistent
-    if(inconsistent(a,b))
-        return true;
+void LandmarksGraph::parallel_for(int size, const function<void(int, int)>& body) {
+/* Run body(i, t) for i in [0, size), spread over get_num_threads() threads;
+   t < get_num_threads() is the thread running it, for per-thread state. */
+    int num_threads = get_num_threads();
+    if(num_threads <= 1 || size <= 1) {
+        for(int i = 0; i < size; i++)
+            body(i, 0);
+        return;
+    }
+    vector<thread> threads;
+    for(int t = 0; t < num_threads && t < size; t++)
+        threads.push_back(thread([t, num_threads, size, &body]() {
+            for(int i = t; i < size; i += num_threads)
+                body(i, t);
+        }));
+    for(int t = 0; t < threads.size(); t++)
+        threads[t].join();
+}
 
-    // 2. Shared effect e in all operators reaching a, and e, b inconsistent
+void LandmarksGraph::shared_effects(const pair<int, int>& a,
+				    vector<pair<int, int> >& result) const {
+/* Collect the effects e shared by all operators reaching a (other than on
+   the variable of a). */
     hash_map<int, int> shared_eff;
     bool init = true;
     const vector<int>& ops = get_operators_including_eff(a);
@@ -550,24 +609,78 @@ bool LandmarksGraph::interferes(const LandmarkNode* node_a, const LandmarkNode*
 	}
 	init = false;
     }
-    // Test whether one of the shared effects is inconsistent with b
-    for(hash_map<int, int>::iterator it = shared_eff.begin(); 
-	it != shared_eff.end(); it++)
-	if(make_pair(it->first, it->second) != a && 
-	   make_pair(it->first, it->second) != b && inconsistent(*it, b)) 
-	    return true;
+    result.assign(shared_eff.begin(), shared_eff.end());
+}
 
-    // 3. Exists LM x, inconsistent x, b and x->_gn a
-    const LandmarkNode& node = *node_a;
+void LandmarksGraph::compute_interference_row(const LandmarkNode* node_a,
+					      unsigned long long* row) const {
+/* Facts a and b interfere (i.e., achieving b before a would mean having to delete b 
+   and re-achieve it in order to achieve a) if one of the following condition holds:
+   1. a and b are inconsistent
+   2. All actions that add a also add e, and e and b are inconsistent
+   3. There is a greedy necessary predecessor x of a, and x and b are inconsistent
+   This is the definition of Hoffmann et al. except that they have one more condition: 
+   "all actions that add a delete b". However, in our case (SAS+ formalism), this condition
+   is the same as 2.
+   Sets in row the facts b inconsistent with a, with a shared effect e or with a
+   greedy necessary predecessor x. (A fact is never inconsistent with itself, so
+   e = b and x = b add nothing.)
+*/
+    assert(!node_a->disjunctive);
+    pair<int, int> a = make_pair(node_a->vars[0], node_a->vals[0]);
+    // 2. Shared effects e in all operators reaching a
+    vector<pair<int, int> > facts;
+    shared_effects(a, facts);
+    // 1. a
+    facts.push_back(a);
+    // 3. LMs x with x ->_gn a
     for(hash_map<LandmarkNode*, edge_type, hash_pointer >::const_iterator it = 
-            node.parents.begin(); it != node.parents.end(); it++) {    
+            node_a->parents.begin(); it != node_a->parents.end(); it++) {    
         edge_type edge = it->second;
-        pair<int, int> parent_prop = make_pair(it->first->vars[0],it->first->vals[0]);  
-        if((edge == n || edge == gn) && parent_prop != b && inconsistent(parent_prop, b))
-            return true;
+        if(edge == n || edge == gn)
+            facts.push_back(make_pair(it->first->vars[0], it->first->vals[0]));
     }
-    // No inconsistency found
-    return false;
+
+    for(int i = 0; i < facts.size(); i++) {
+        int var = facts[i].first, val = facts[i].second;
+        // Other values of the same variable
+        for(int other = 0; other < g_variable_domain[var]; other++)
+            if(other != val)
+                set_bit(row, fact_offset[var] + other);
+        if(use_external_inconsistencies) {
+            // Facts sharing an invariant group
+            int fact = fact_id(facts[i]);
+            for(int j = fact_group_begin[fact]; j < fact_group_begin[fact + 1]; j++) {
+                int group = fact_groups[j];
+                for(int k = group_begin[group]; k < group_begin[group + 1]; k++)
+                    if(group_facts[k] != fact)
+                        set_bit(row, group_facts[k]);
+            }
+        }
+    }
+}
+
+void LandmarksGraph::compute_interference_rows() {
+    vector<const LandmarkNode*> simple_nodes;
+    for(set<LandmarkNode*>::iterator it = nodes.begin(); it != nodes.end(); it++)
+        if(!(*it)->disjunctive) {
+            interference_row_index.insert(make_pair(*it, int(simple_nodes.size())));
+            simple_nodes.push_back(*it);
+        }
+    interference_rows.assign(simple_nodes.size() * fact_row_words, 0);
+    parallel_for(simple_nodes.size(), [this, &simple_nodes](int i, int) {
+        compute_interference_row(simple_nodes[i], &interference_rows[size_t(i) * fact_row_words]);
+    });
+}
+
+bool LandmarksGraph::interferes(const LandmarkNode* node_a, const LandmarkNode* node_b) const {
+    assert(!node_a->disjunctive && ! node_b->disjunctive);
+    assert(node_a->vars[0] != node_b->vars[0] || node_a->vals[0] != node_b->vals[0]);
+    hash_map<const LandmarkNode*, int, hash_pointer>::const_iterator it =
+        interference_row_index.find(node_a);
+    assert(it != interference_row_index.end());
+    return test_bit(&interference_rows[size_t(it->second) * fact_row_words],
+                    fact_id(make_pair(node_b->vars[0], node_b->vals[0])));
 }
 
 inline static bool _in_goal(const pair<int,int>& l) {
@@ -583,66 +696,73 @@ void LandmarksGraph::approximate_reasonable_orders(bool obedient_orders) {
 /* Approximate reasonable and obedient reasonable orders according to Hoffmann et al. If flag
    "obedient_orders" is true, we calculate obedient reasonable orders, otherwise reasonable orders. 
 
-   If node_p is in goal, then any node2_p which interferes with node_p can be reasonably ordered 
+   The landmarks to order before each node are collected concurrently: they only depend
+   on interference and on the necessary (and, for obedient orders, reasonable) orders,
+   which adding the new orders does not change. The edges are then added in the order of
+   the nodes, as edge_add resolves two opposite orders by which one comes first.
+ */
+    vector<LandmarkNode*> targets(nodes.begin(), nodes.end());
+    vector<vector<LandmarkNode*> > ordered_before(targets.size());
+    parallel_for(targets.size(), [this, obedient_orders, &targets, &ordered_before](int i, int) {
+        collect_reasonable_orders(targets[i], obedient_orders, ordered_before[i]);
+    });
+    for(int i = 0; i < targets.size(); i++)
+        for(int j = 0; j < ordered_before[i].size(); j++)
+            edge_add(*ordered_before[i][j], *targets[i], obedient_orders ? o_r : r);
+}
+
+void LandmarksGraph::collect_reasonable_orders(LandmarkNode* node_p, bool obedient_orders,
+                                               vector<LandmarkNode*>& ordered_before) {
+/* If node_p is in goal, then any node2_p which interferes with node_p can be reasonably ordered 
    before node_p. Otherwise, if node_p is greedy necessary predecessor of node2, and there is another
    predecessor "parent" of node2, then parent and all predecessors of parent can be ordered reasonably 
    before node_p if they interfere with node_p.
  */
-    for(set<LandmarkNode*>::iterator it = nodes.begin(); it != nodes.end(); it++) {
-        LandmarkNode* node_p = *it;
-        if(node_p->disjunctive)
-            continue;
-        pair<int, int> node_prop = make_pair(node_p->vars[0], node_p->vals[0]);
-
-        if(!obedient_orders &&_in_goal(node_prop)) {
-            for(set<LandmarkNode*>::iterator it2 = nodes.begin(); it2 != nodes.end(); it2++) {
-                LandmarkNode* node2_p = *it2;
-                if(node2_p->disjunctive)
-                    continue;
-                pair<int, int> node2_prop = make_pair(node2_p->vars[0], node2_p->vals[0]);
-                if(node_prop != node2_prop && interferes(node2_p, node_p)) {
-		    edge_add(*node2_p, *node_p, r);
-                }
-            }
+    if(node_p->disjunctive)
+        return;
+    pair<int, int> node_prop = make_pair(node_p->vars[0], node_p->vals[0]);
+
+    if(!obedient_orders &&_in_goal(node_prop)) {
+        for(set<LandmarkNode*>::iterator it2 = nodes.begin(); it2 != nodes.end(); it2++) {
+            LandmarkNode* node2_p = *it2;
+            if(node2_p->disjunctive)
+                continue;
+            pair<int, int> node2_prop = make_pair(node2_p->vars[0], node2_p->vals[0]);
+            if(node_prop != node2_prop && interferes(node2_p, node_p))
+                ordered_before.push_back(node2_p);
         }
-        else if(!node_p->is_true_in_state(*g_initial_state)) {
-            // Collect candidates for reasonable orders in "interesting nodes". 
-            // Use hash set to filter duplicates.
-            hash_set<LandmarkNode*, hash_pointer> interesting_nodes(g_variable_name.size());
-            for(hash_map<LandmarkNode*, edge_type, hash_pointer >::iterator 
-                    it = node_p->children.begin(); it != node_p->children.end(); it++) {
-                if(it->second == gn) { // found node2: node_p ->_gn node2
-                    LandmarkNode& node2 = *(it->first);
-                    for(hash_map<LandmarkNode*, edge_type, hash_pointer>::iterator 
-                            it2 = node2.parents.begin(); it2 != node2.parents.end(); it2++) { // find parent
-                        edge_type& edge = it2->second;
-                        LandmarkNode& parent = *(it2->first);
-			if(parent.disjunctive)
-                            continue;
-                        if( (edge == gn || edge == n || edge == ln || (obedient_orders && edge == r)) && 
-                            &parent != node_p) { // find predecessors or parent and collect in "interesting nodes" 
-                            interesting_nodes.insert(&parent);
-                            collect_ancestors(interesting_nodes, parent, obedient_orders);
-                        }
+    }
+    else if(!node_p->is_true_in_state(*g_initial_state)) {
+        // Collect candidates for reasonable orders in "interesting nodes". 
+        // Use hash set to filter duplicates.
+        hash_set<LandmarkNode*, hash_pointer> interesting_nodes(g_variable_name.size());
+        for(hash_map<LandmarkNode*, edge_type, hash_pointer >::iterator 
+                it = node_p->children.begin(); it != node_p->children.end(); it++) {
+            if(it->second == gn) { // found node2: node_p ->_gn node2
+                LandmarkNode& node2 = *(it->first);
+                for(hash_map<LandmarkNode*, edge_type, hash_pointer>::iterator 
+                        it2 = node2.parents.begin(); it2 != node2.parents.end(); it2++) { // find parent
+                    edge_type& edge = it2->second;
+                    LandmarkNode& parent = *(it2->first);
+                    if(parent.disjunctive)
+                        continue;
+                    if( (edge == gn || edge == n || edge == ln || (obedient_orders && edge == r)) && 
+                        &parent != node_p) { // find predecessors or parent and collect in "interesting nodes" 
+                        interesting_nodes.insert(&parent);
+                        collect_ancestors(interesting_nodes, parent, obedient_orders);
                     }
                 }
             }
-	    // Insert reasonable orders between those members of "interesting nodes" that interfere 
-	    // with node_p. 
-            for(hash_set<LandmarkNode*, hash_pointer>::iterator 
-                    it3 = interesting_nodes.begin(); it3 != interesting_nodes.end(); it3++) {
-                if((*it3)->disjunctive)
-                    continue;
-                pair<int, int> it_prop = make_pair((*it3)->vars[0], (*it3)->vals[0]);
-                if(it_prop != node_prop && interferes(*it3, node_p)) {
-		    if(!obedient_orders)
-			edge_add(**it3, *node_p, r);
-		    else
-			edge_add(**it3, *node_p, o_r);
-		}
-            }
         }
-
+        // Order before node_p those members of "interesting nodes" that interfere with it.
+        for(hash_set<LandmarkNode*, hash_pointer>::iterator 
+                it3 = interesting_nodes.begin(); it3 != interesting_nodes.end(); it3++) {
+            if((*it3)->disjunctive)
+                continue;
+            pair<int, int> it_prop = make_pair((*it3)->vars[0], (*it3)->vals[0]);
+            if(it_prop != node_prop && interferes(*it3, node_p))
+                ordered_before.push_back(*it3);
+        }
     }
 }
 
@@ -919,3 +1039,253 @@ int LandmarksGraph::calculate_lms_cost() const {
 
     return result;
 }
+
+/* Landmarks graph cache. The file holds a header (magic, fingerprint,
+   landmarks count and cost, number of nodes) followed by the nodes in the
+   order of the node set; each node is stored as its flags, min_cost and
+   facts, followed by its children as (node index, edge type) pairs. All
+   fields are 32 bit and in native byte order, as the cache is only read on
+   the machine that wrote it. */
+
+static const char landmarks_cache_magic[8] = {'L', 'M', 'G', 'R', 'A', 'P', 'H', '1'};
+
+static inline void fingerprint_add(unsigned long long &hash, const void *data, size_t size) {
+    // FNV-1a
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for(size_t i = 0; i < size; i++) {
+	hash ^= bytes[i];
+	hash *= 1099511628211ULL;
+    }
+}
+
+static inline void fingerprint_add(unsigned long long &hash, int value) {
+    fingerprint_add(hash, &value, sizeof(value));
+}
+
+static inline void fingerprint_add(unsigned long long &hash, float value) {
+    fingerprint_add(hash, &value, sizeof(value));
+}
+
+static inline void fingerprint_add(unsigned long long &hash, const string &value) {
+    fingerprint_add(hash, int(value.size()));
+    fingerprint_add(hash, value.data(), value.size());
+}
+
+static void fingerprint_add(unsigned long long &hash, const Operator &op) {
+    fingerprint_add(hash, op.get_name());
+    fingerprint_add(hash, op.get_cost());
+    fingerprint_add(hash, op.get_runtime_cost());
+    const vector<Prevail> &prevail = op.get_prevail();
+    fingerprint_add(hash, int(prevail.size()));
+    for(int i = 0; i < prevail.size(); i++) {
+	fingerprint_add(hash, prevail[i].var);
+	fingerprint_add(hash, prevail[i].prev);
+    }
+    const vector<PrePost> &pre_post = op.get_pre_post();
+    fingerprint_add(hash, int(pre_post.size()));
+    for(int i = 0; i < pre_post.size(); i++) {
+	fingerprint_add(hash, pre_post[i].var);
+	fingerprint_add(hash, pre_post[i].pre);
+	fingerprint_add(hash, pre_post[i].post);
+	fingerprint_add(hash, pre_post[i].f_cost);
+	fingerprint_add(hash, pre_post[i].runtime_cost_effect);
+	fingerprint_add(hash, int(pre_post[i].cond.size()));
+	for(int j = 0; j < pre_post[i].cond.size(); j++) {
+	    fingerprint_add(hash, pre_post[i].cond[j].var);
+	    fingerprint_add(hash, pre_post[i].cond[j].prev);
+	}
+    }
+}
+
+unsigned long long LandmarksGraph::task_fingerprint(bool reasonable_orders) {
+    unsigned long long hash = 14695981039346656037ULL;
+    fingerprint_add(hash, landmarks_cache_magic, sizeof(landmarks_cache_magic));
+    fingerprint_add(hash, int(reasonable_orders));
+    // The metric sets the operator costs of the explorations
+    fingerprint_add(hash, int(g_use_metric));
+    fingerprint_add(hash, int(g_length_metric));
+    fingerprint_add(hash, int(g_use_metric_total_time));
+    fingerprint_add(hash, g_op_metric);
+    fingerprint_add(hash, int(g_n_metric.size()));
+    for(int i = 0; i < g_n_metric.size(); i++)
+	fingerprint_add(hash, g_n_metric[i]);
+    fingerprint_add(hash, int(g_variable_domain.size()));
+    for(int var = 0; var < g_variable_domain.size(); var++) {
+	fingerprint_add(hash, g_variable_name[var]);
+	fingerprint_add(hash, g_variable_domain[var]);
+    }
+    fingerprint_add(hash, int(g_goal.size()));
+    for(int i = 0; i < g_goal.size(); i++) {
+	fingerprint_add(hash, g_goal[i].first);
+	fingerprint_add(hash, g_goal[i].second);
+    }
+    fingerprint_add(hash, int(g_operators.size()));
+    for(int i = 0; i < g_operators.size(); i++)
+	fingerprint_add(hash, g_operators[i]);
+    fingerprint_add(hash, int(g_axioms.size()));
+    for(int i = 0; i < g_axioms.size(); i++)
+	fingerprint_add(hash, g_axioms[i]);
+    unsigned long long state_hash = g_initial_state->get_hash();
+    fingerprint_add(hash, &state_hash, sizeof(state_hash));
+
+    ifstream groups("all.groups");
+    if(groups.is_open()) {
+	stringstream contents;
+	contents << groups.rdbuf();
+	fingerprint_add(hash, contents.str());
+    } else {
+	fingerprint_add(hash, -1);
+    }
+    return hash;
+}
+
+bool LandmarksGraph::read_cache(const char *filename, unsigned long long fingerprint) {
+    int fd = open(filename, O_RDONLY);
+    if(fd == -1)
+	return false;
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) == -1 || file_stat.st_size < sizeof(landmarks_cache_magic) +
+       sizeof(fingerprint)) {
+	close(fd);
+	return false;
+    }
+    size_t size = file_stat.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED)
+	return false;
+
+    const char *data = static_cast<const char *>(mapping);
+    const char *end = data + size;
+    bool valid = memcmp(data, landmarks_cache_magic, sizeof(landmarks_cache_magic)) == 0;
+    data += sizeof(landmarks_cache_magic);
+    unsigned long long stored_fingerprint;
+    memcpy(&stored_fingerprint, data, sizeof(stored_fingerprint));
+    data += sizeof(stored_fingerprint);
+    valid = valid && stored_fingerprint == fingerprint;
+
+    // Reads the next 32 bit field, invalidating the cache if the file is short
+#define READ_FIELD(field) \
+    if(valid && end - data >= 4) { memcpy(&(field), data, 4); data += 4; } else valid = false
+
+    int count = 0, cost = 0, num_nodes = 0;
+    READ_FIELD(count);
+    READ_FIELD(cost);
+    READ_FIELD(num_nodes);
+    vector<LandmarkNode*> cached_nodes;
+    if(valid && num_nodes >= 0 && num_nodes <= (end - data) / 16) {
+	cached_nodes.reserve(num_nodes);
+	for(int i = 0; i < num_nodes; i++) {
+	    vector<int> vars, vals;
+	    cached_nodes.push_back(new LandmarkNode(vars, vals, false));
+	}
+    } else {
+	valid = false;
+    }
+    for(int i = 0; valid && i < num_nodes; i++) {
+	LandmarkNode &node = *cached_nodes[i];
+	int flags = 0, num_facts = 0, num_children = 0;
+	READ_FIELD(flags);
+	READ_FIELD(node.min_cost);
+	READ_FIELD(num_facts);
+	node.disjunctive = flags & 1;
+	node.in_goal = flags & 2;
+	for(int j = 0; valid && j < num_facts; j++) {
+	    int var = -1, val = -1;
+	    READ_FIELD(var);
+	    READ_FIELD(val);
+	    if(var < 0 || var >= g_variable_domain.size() || val < 0 || val >= g_variable_domain[var])
+		valid = false;
+	    node.vars.push_back(var);
+	    node.vals.push_back(val);
+	}
+	if(num_facts < 1 || (!node.disjunctive && num_facts != 1))
+	    valid = false;
+	READ_FIELD(num_children);
+	for(int j = 0; valid && j < num_children; j++) {
+	    int child = -1, type = -1;
+	    READ_FIELD(child);
+	    READ_FIELD(type);
+	    if(child < 0 || child >= num_nodes || child == i || type < o_r || type > n) {
+		valid = false;
+		break;
+	    }
+	    node.children[cached_nodes[child]] = edge_type(type);
+	    cached_nodes[child]->parents[&node] = edge_type(type);
+	}
+    }
+#undef READ_FIELD
+    munmap(mapping, size);
+
+    if(!valid || data != end) {
+	for(int i = 0; i < cached_nodes.size(); i++)
+	    delete cached_nodes[i];
+	return false;
+    }
+    for(int i = 0; i < num_nodes; i++) {
+	LandmarkNode *node = cached_nodes[i];
+	nodes.insert(node);
+	for(int j = 0; j < node->vars.size(); j++) {
+	    pair<int, int> fact = make_pair(node->vars[j], node->vals[j]);
+	    if(node->disjunctive)
+		disj_lms_to_nodes.insert(make_pair(fact, node));
+	    else
+		simple_lms_to_nodes.insert(make_pair(fact, node));
+	}
+    }
+    landmarks_count = count;
+    landmarks_cost = cost;
+    build_fact_index();
+    return true;
+}
+
+void LandmarksGraph::write_cache(const char *filename, unsigned long long fingerprint) const {
+    hash_map<const LandmarkNode*, int, hash_pointer> node_index;
+    for(set<LandmarkNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+	node_index.insert(make_pair(*it, int(node_index.size())));
+
+    vector<int> fields;
+    fields.push_back(landmarks_count);
+    fields.push_back(landmarks_cost);
+    fields.push_back(nodes.size());
+    for(set<LandmarkNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+	const LandmarkNode &node = **it;
+	int min_cost;
+	memcpy(&min_cost, &node.min_cost, sizeof(min_cost));
+	fields.push_back((node.disjunctive ? 1 : 0) | (node.in_goal ? 2 : 0));
+	fields.push_back(min_cost);
+	fields.push_back(node.vars.size());
+	for(int i = 0; i < node.vars.size(); i++) {
+	    fields.push_back(node.vars[i]);
+	    fields.push_back(node.vals[i]);
+	}
+	fields.push_back(node.children.size());
+	for(hash_map<LandmarkNode*, edge_type, hash_pointer>::const_iterator child =
+		node.children.begin(); child != node.children.end(); ++child) {
+	    fields.push_back(node_index[child->first]);
+	    fields.push_back(child->second);
+	}
+    }
+
+    // Written to a temporary file of its own first, so that concurrent
+    // readers never see a partial cache and concurrent writers do not
+    // write into the same file
+    string tmp_filename = string(filename) + ".XXXXXX";
+    int fd = mkstemp(&tmp_filename[0]);
+    FILE *out = fd == -1 ? NULL : fdopen(fd, "wb");
+    bool written = out != NULL;
+    if(out != NULL) {
+	fchmod(fd, 0644);
+	written = fwrite(landmarks_cache_magic, sizeof(landmarks_cache_magic), 1, out) == 1 &&
+	    fwrite(&fingerprint, sizeof(fingerprint), 1, out) == 1 &&
+	    fwrite(&fields[0], sizeof(int), fields.size(), out) == fields.size();
+	written = fclose(out) == 0 && written;
+    } else if(fd != -1) {
+	close(fd);
+    }
+    if(!written || rename(tmp_filename.c_str(), filename) != 0) {
+	cout << "Could not write landmarks graph cache " << filename << endl;
+	if(fd != -1)
+	    remove(tmp_filename.c_str());
+    }
+}
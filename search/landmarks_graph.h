@@ -28,6 +28,7 @@
 #include <map>
 #include <ext/hash_map>
 #include <list>
+#include <functional>
 #include <ext/hash_set>
 #include <cassert>
 #include <cfloat>
@@ -92,6 +93,16 @@ public:
     void use_reasonable_orders() {reasonable_orders = true;}
 
     void generate();
+
+    /* The generated graph can be stored in a binary cache file, keyed by a
+       fingerprint of everything generation depends on (operators, goals,
+       metric, invariant groups, initial state and options), so that
+       relaunching the planner on the same task does not generate it
+       again. */
+    static unsigned long long task_fingerprint(bool reasonable_orders);
+    bool read_cache(const char *filename, unsigned long long fingerprint);
+    void write_cache(const char *filename, unsigned long long fingerprint) const;
+
     bool simple_landmark_exists(const pair<int, int>& lm) const;
     bool disj_landmark_exists(const set<pair<int, int> >& lm) const;
     bool landmark_exists(const pair<int, int>& lm) const; 
@@ -128,6 +139,11 @@ public:
         return nodes;
     }
 
+    // Nodes having (var, val) among their facts, indexed after generation
+    inline const vector<const LandmarkNode*>& get_nodes_with_fact(int var, int val) const {
+        return nodes_by_fact[var][val];
+    }
+
     inline const vector<int>& get_operators_including_eff(const pair<int, int>& eff) const {
         return operators_eff_lookup[eff.first][eff.second];
     }
@@ -141,6 +157,16 @@ public:
 	return op;
     }
 private:
+    /* Facts b that a simple landmark a interferes with, as one row of
+       fact bits per simple landmark. They only depend on the operators
+       achieving a and on its (greedy) necessary orders, which adding
+       reasonable orders does not change, so they are computed once before
+       the reasonable orders are approximated. */
+    hash_map<const LandmarkNode*, int, hash_pointer> interference_row_index;
+    vector<unsigned long long> interference_rows;
+    void shared_effects(const pair<int, int>& a, vector<pair<int, int> >& result) const;
+    void compute_interference_row(const LandmarkNode* node_a, unsigned long long* row) const;
+    void compute_interference_rows();
     bool interferes(const LandmarkNode*, const LandmarkNode*) const;
     bool effect_always_happens(const vector<PrePost>& prepost, 
                                set<pair<int, int> >& eff) const;
@@ -149,7 +175,11 @@ private:
     vector<vector<vector<int> > > operators_eff_lookup;
     vector<vector<vector<int> > > operators_pre_lookup;
     void generate_operators_lookups();
+    vector<vector<vector<const LandmarkNode*> > > nodes_by_fact;
+    void build_fact_index();
     void approximate_reasonable_orders(bool obedient_orders);
+    void collect_reasonable_orders(LandmarkNode* node_p, bool obedient_orders,
+                                   vector<LandmarkNode*>& ordered_before);
     void mk_acyclic_graph();
     int loop_acyclic_graph(LandmarkNode& lmn, 
                            hash_set<LandmarkNode*, hash_pointer>& acyclic_node_set);
@@ -166,7 +196,31 @@ private:
     bool use_external_inconsistencies;
     bool reasonable_orders;
 
-    vector<vector<set<pair<int, int> > > > inconsistent_facts;
+    /* Invariant groups over facts numbered densely per variable: facts
+       in a common group are mutually exclusive. Both directions are kept
+       as flat lists, so memory is linear in the total size of the groups:
+       the members of group g are group_facts[group_begin[g] ..
+       group_begin[g + 1]), the groups of fact f, in ascending order, are
+       fact_groups[fact_group_begin[f] .. fact_group_begin[f + 1]). The
+       numbering is set up by the constructor, the lists when reading the
+       groups. */
+    vector<int> fact_offset;
+    int num_facts;
+    int fact_row_words; // 64 bit words per row of fact bits
+    vector<int> group_begin;
+    vector<int> group_facts;
+    vector<int> fact_group_begin;
+    vector<int> fact_groups;
+    int fact_id(const pair<int, int>& fact) const {
+        return fact_offset[fact.first] + fact.second;
+    }
+    static bool test_bit(const unsigned long long* row, int bit) {
+        return (row[bit / 64] >> (bit % 64)) & 1;
+    }
+    static void set_bit(unsigned long long* row, int bit) {
+        row[bit / 64] |= 1ULL << (bit % 64);
+    }
+    bool in_mutex_group(const pair<int, int>& a, const pair<int, int>& b) const;
 
 protected:
 
@@ -179,6 +233,7 @@ protected:
     map<string, int> pddl_proposition_indeces; //TODO: make this a hash_map
 
     bool inconsistent(const pair<int,int>& a, const pair<int,int>& b) const;
+    static void parallel_for(int size, const function<void(int, int)>& body);
     void collect_ancestors(hash_set<LandmarkNode*, hash_pointer>& result, LandmarkNode& node, 
                            bool use_reasonable);
     inline bool relaxed_task_solvable(bool level_out,
@@ -188,11 +243,13 @@ protected:
 	vector<hash_map<pair<int, int>, int, hash_int_pair> > lvl_op;
         return relaxed_task_solvable(lvl_var, lvl_op, level_out, exclude, compute_lvl_op);
     }
+    // The exploration runs in explorer, g_ff_heur if none is given
     bool relaxed_task_solvable(vector<vector<int> >& lvl_var,
 			       vector<hash_map<pair<int, int>, int, hash_int_pair> >& lvl_op,
                                bool level_out, 
                                const LandmarkNode* exclude,
-			       bool compute_lvl_op = false) const;
+			       bool compute_lvl_op = false,
+			       FFHeuristic* explorer = NULL) const;
 
     LandmarkNode& landmark_add_simple(const pair<int, int>& lm); 
     LandmarkNode& landmark_add_disjunctive(const set<pair<int, int> >& lm); 
@@ -31,6 +31,7 @@
 #include "state.h"
 #include "globals.h"
 #include "domain_transition_graph.h"
+#include "ff_heuristic.h"
 
 using namespace __gnu_cxx;
 
@@ -376,12 +377,54 @@ compute_predecessor_information(LandmarkNode* bp,
        (in lvl_var) in a relaxed plan that excludes bp, and similarly 
        when operators can be applied (in lvl_op).  */
 
+    map<const LandmarkNode*, PredecessorInformation>::iterator it =
+	precomputed_information.find(bp);
+    if(it != precomputed_information.end()) {
+	bool unchanged = it->second.vars == bp->vars && it->second.vals == bp->vals;
+	if(unchanged) {
+	    lvl_var.swap(it->second.lvl_var);
+	    lvl_op.swap(it->second.lvl_op);
+	}
+	precomputed_information.erase(it);
+	if(unchanged)
+	    return;
+    }
     relaxed_task_solvable(lvl_var, lvl_op, true, bp);
 }
 
+void LandmarksGraphNew::precompute_predecessor_information() {
+    // Explorations for the next open landmarks that need one
+    vector<const LandmarkNode*> batch;
+    int batch_size = 4 * explorers.size();
+    for(list<LandmarkNode*>::const_iterator it = open_landmarks.begin();
+	it != open_landmarks.end() && batch.size() < batch_size; ++it) {
+	const LandmarkNode* node = *it;
+	if(!node->is_true_in_state(*g_initial_state) &&
+	   precomputed_information.find(node) == precomputed_information.end() &&
+	   find(batch.begin(), batch.end(), node) == batch.end())
+	    batch.push_back(node);
+    }
+
+    // One explorer per thread of parallel_for
+    vector<PredecessorInformation> results(batch.size());
+    parallel_for(batch.size(), [this, &batch, &results](int i, int t) {
+	results[i].vars = batch[i]->vars;
+	results[i].vals = batch[i]->vals;
+	relaxed_task_solvable(results[i].lvl_var, results[i].lvl_op, true,
+			      batch[i], false, explorers[t]);
+    });
+
+    for(int i = 0; i < batch.size(); i++)
+	precomputed_information[batch[i]].swap(results[i]);
+}
+
 void LandmarksGraphNew::generate_landmarks() {
     relaxed_task_solvable(true, NULL);
     cout << "Generating landmarks using the RPG/SAS+ approach\n";
+    int num_threads = get_num_threads();
+    if(num_threads > 1)
+	for(int t = 0; t < num_threads; t++)
+	    explorers.push_back(new FFHeuristic(*g_ff_heur));
     for(unsigned i = 0; i < g_goal.size(); i++) {
 		LandmarkNode& lmn = landmark_add_simple(g_goal[i]);
 		lmn.in_goal = true;
@@ -389,6 +432,9 @@ void LandmarksGraphNew::generate_landmarks() {
     }
     while(!open_landmarks.empty()) {
         LandmarkNode* bp = open_landmarks.front();
+        if(!explorers.empty() && !bp->is_true_in_state(*g_initial_state) &&
+           precomputed_information.find(bp) == precomputed_information.end())
+            precompute_predecessor_information();
         open_landmarks.pop_front();
 	assert(bp->forward_orders.empty());
 
@@ -424,6 +470,10 @@ void LandmarksGraphNew::generate_landmarks() {
 			}
         }
     }
+    for(int t = 0; t < explorers.size(); t++)
+	delete explorers[t];
+    explorers.clear();
+    precomputed_information.clear();
     add_lm_forward_orders();
 }
 
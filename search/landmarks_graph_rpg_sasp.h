@@ -30,6 +30,28 @@
 class LandmarksGraphNew : public LandmarksGraph {
 
     list<LandmarkNode*> open_landmarks;
+
+    /* The exclusion explorations of the landmarks at the front of
+       open_landmarks are computed ahead, concurrently, each thread on its
+       own copy of g_ff_heur. Landmarks are still processed one at a time in
+       the order of open_landmarks, so the graph is the same as with a
+       serial generation; a result is discarded if the landmark changed
+       (disjunctive made simple) after its exploration. */
+    struct PredecessorInformation {
+	vector<int> vars;
+	vector<int> vals;
+	vector<vector<int> > lvl_var;
+	vector<hash_map<pair<int, int>, int, hash_int_pair> > lvl_op;
+	void swap(PredecessorInformation &other) {
+	    vars.swap(other.vars);
+	    vals.swap(other.vals);
+	    lvl_var.swap(other.lvl_var);
+	    lvl_op.swap(other.lvl_op);
+	}
+    };
+    map<const LandmarkNode*, PredecessorInformation> precomputed_information;
+    vector<FFHeuristic*> explorers;
+    void precompute_predecessor_information();
  
     void find_forward_orders(const vector<vector<int> >& lvl_var, LandmarkNode* lmp);
     void add_lm_forward_orders();
@@ -34,6 +34,8 @@
 
 class Variable;
 
+enum snap_type {no_snap, start_snap, end_snap};
+
 struct Prevail {
     int var;
     int prev;
@@ -49,14 +51,18 @@ struct Prevail {
     void dump() const;
 };
 
+struct CompiledRuntimeEffect;
+
 struct PrePost {
     int var;
     int pre, post;
-    float f_cost;
-    bool have_runtime_cost_effect;
-    bool have_module_cost_effect;
+    float f_cost = 0;
+    bool have_runtime_cost_effect = false;
+    bool have_module_cost_effect = false;
     std::string runtime_cost_effect;
-    bool is_conditional_effect;
+    int ext_func = -1; // external function table index of module cost effects
+    const CompiledRuntimeEffect *runtime_effect = 0; // compiled runtime_cost_effect
+    bool is_conditional_effect = false;
     std::vector<Prevail> cond;
     PrePost() {} // Needed for axiom file-reading constructor, unfortunately.
     PrePost(std::istream &in);
@@ -91,13 +97,26 @@ class Operator {
     std::string name;
 	std::string non_temporal_name;
     float cost;
-    bool have_runtime_cost;
-    bool have_module_cost;
+    bool have_runtime_cost = false;
+    bool have_module_cost = false;
     string runtime_cost;
+    int runtime_cost_func = -1; // external function table index of module costs
+    const CompiledRuntimeEffect *compiled_runtime_cost = 0;
+
+    // Metadata computed once at load time (see compute_operator_metadata)
+    snap_type snap = no_snap;
+    int paired_op = -1;              // matching _start/_end snap action, -1 if none
+    int duration_effect = -1;        // index in pre_post of the total-time effect, -1 if none
+    std::vector<int> numeric_pre;    // indices in pre_post of -5/-6 conditions
+    std::vector<int> shared_effects; // indices in pre_post touching shared vars
+    friend void compute_operator_metadata();
+    friend void fold_static_runtime_effects();
+    friend void resolve_external_functions();
+    friend void compile_runtime_effects();
 public:
     Operator(std::istream &in, bool is_axiom);
     void dump() const;
-    std::string get_name() const {return name;}
+    const std::string &get_name() const {return name;}
 
     bool is_axiom() const {return is_an_axiom;}
 
@@ -116,10 +135,22 @@ public:
     }
     bool get_have_runtime_cost() const {return have_runtime_cost;};
     bool get_have_module_cost() const {return have_module_cost;};
-    string get_runtime_cost() const {return runtime_cost;};
-    string get_non_temporal_action_name() const {return non_temporal_name;};
+    const string &get_runtime_cost() const {return runtime_cost;};
+    int get_runtime_cost_func() const {return runtime_cost_func;};
+    const CompiledRuntimeEffect *get_compiled_runtime_cost() const {return compiled_runtime_cost;};
+    const string &get_non_temporal_action_name() const {return non_temporal_name;};
     float get_cost() const {return cost;};
 
+    snap_type get_snap_type() const {return snap;};
+    bool is_start_snap() const {return snap == start_snap;};
+    bool is_end_snap() const {return snap == end_snap;};
+    int get_paired_op() const {return paired_op;};
+    const PrePost *get_duration_effect() const {
+	return duration_effect == -1 ? 0 : &pre_post[duration_effect];
+    }
+    const std::vector<int> &get_numeric_pre() const {return numeric_pre;};
+    const std::vector<int> &get_shared_effects() const {return shared_effects;};
+
 };
 
 #endif
@@ -25,6 +25,7 @@
 #include "best_first_search.h"
 #include "wa_star_search.h"
 #include "ff_heuristic.h"
+#include "temporal_heuristic.h"
 #include "globals.h"
 #include "operator.h"
 #include "landmarks_graph.h"
@@ -46,6 +47,7 @@
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <cstdlib>
 
 using namespace std;
 
@@ -60,7 +62,9 @@ void print_vars_end_state(ofstream& state_outfile, vector<int> vars_end_state, v
 
 void print_heuristics_used(bool ff_heuristic, bool ff_preferred_operators, 
 			   bool landmarks_heuristic, 
-			   bool landmarks_heuristic_preferred_operators);
+			   bool landmarks_heuristic_preferred_operators,
+			   bool temporal_heuristic,
+			   bool temporal_preferred_operators);
 void save_plan_timelines(const vector<const Operator *> &plan, const float cost, const string& filename,
 		int iteration, vector<float> plan_temporal_info, vector<float> plan_duration_info,
 		vector<float> plan_cost_info, vector<int> vars_end_state, vector<float> num_vars_end_state,
@@ -76,10 +80,12 @@ int main(int argc, const char **argv) {
     
     bool ff_heuristic = false, ff_preferred_operators = false;
     bool landmarks_heuristic = false, landmarks_preferred_operators = false;
+    bool temporal_heuristic = false, temporal_preferred_operators = false;
     bool reasonable_orders = true;
     bool iterative_search = false;
     bool read_init_state = false;
     bool read_runtime_constraints = false;
+    bool async_external_functions = false;
 
     std::fstream fs;
 
@@ -97,6 +103,10 @@ int main(int argc, const char **argv) {
                 landmarks_heuristic = true; 
             } else if(*c == 'L') {
                 landmarks_preferred_operators = true; 
+	    } else if(*c == 't') {
+		temporal_heuristic = true;
+	    } else if(*c == 'T') {
+		temporal_preferred_operators = true;
 	    } else if(*c == 'w') {
                 search_type = wa_star;
 	    } else if(*c == 'i') {
@@ -107,6 +117,9 @@ int main(int argc, const char **argv) {
 	    	read_init_state = true;
 	    } else if(*c == 'h'){
 	    	use_hard_temporal_constraints = true;
+	    } else if(*c == 'a'){
+	    	// Module functions must be thread-safe
+	    	async_external_functions = true;
 	    } else {
 			cerr << "Unknown option: " << *c << endl;
 			return 1;
@@ -120,7 +133,7 @@ int main(int argc, const char **argv) {
 
     fs >> agent_name;
 
-    if(!ff_heuristic && !landmarks_heuristic) {
+    if(!ff_heuristic && !landmarks_heuristic && !temporal_heuristic) {
 	cerr << "Error: you must select at least one heuristic!" << endl
 	     << "If you are unsure, choose options \"fFlL\"." << endl;
 	return 2;
@@ -131,6 +144,13 @@ int main(int argc, const char **argv) {
 	cout << "Starting normal solver." << endl;
     }
 
+    // Threads used by landmark generation and the module function workers
+    if(getenv("MALAMA_THREADS") != NULL)
+	g_max_threads = max(1, atoi(getenv("MALAMA_THREADS")));
+    // Landmark graphs are cached in the working directory unless disabled
+    if(getenv("MALAMA_LANDMARKS_CACHE") != NULL && string(getenv("MALAMA_LANDMARKS_CACHE")) == "0")
+	g_use_landmarks_cache = false;
+
     // Read input and generate landmarks
     bool generate_landmarks = false;
     g_lgraph = NULL; 
@@ -140,6 +160,8 @@ int main(int argc, const char **argv) {
     times(&landmarks_generation_start);
     read_everything(fs, generate_landmarks, reasonable_orders, read_init_state, read_runtime_constraints);
     load_external_modules();
+    if(async_external_functions)
+	g_ext_func_manager.start_workers(get_num_threads());
 
     if (use_hard_temporal_constraints && (g_timed_goals.size() != 0)) {
     	cout << "Hard temporal constraints and timed goals are currently not supported at the same time." << endl;
@@ -163,7 +185,7 @@ int main(int argc, const char **argv) {
 	    landmarks_heuristic = false;
 	}
 
-	if(!ff_heuristic) {
+	if(!ff_heuristic && !temporal_heuristic) {
 	    cout << "Using FF heuristic with preferred operators." << endl;
 	    ff_heuristic = true;
 	    ff_preferred_operators = true;
@@ -174,7 +196,11 @@ int main(int argc, const char **argv) {
     bool solution_found = false;
     int wa_star_weights[] = {10, 5, 3, 2, 1, -1};
     float wastar_bound = -1;
+    // The FF and temporal heuristics are kept for all iterations and cache
+    // their evaluations, which reopened states and restarts reuse. Landmark
+    // counts depend on the path to a state and are not cached.
     g_ff_heur = NULL;
+    TemporalHeuristic *temporal_heur = NULL;
     int wastar_weight = wa_star_weights[0];
     bool reducing_weight = true;
 	do{
@@ -198,11 +224,12 @@ int main(int argc, const char **argv) {
 			engine = new BestFirstSearchEngine;
 
 		print_heuristics_used(ff_heuristic, ff_preferred_operators,
-					  landmarks_heuristic, landmarks_preferred_operators);
+					  landmarks_heuristic, landmarks_preferred_operators,
+					  temporal_heuristic, temporal_preferred_operators);
 		if(landmarks_heuristic || landmarks_preferred_operators) {
 			if(landmarks_preferred_operators)
 			if(!g_ff_heur)
-				g_ff_heur = new FFHeuristic;
+				g_ff_heur = new FFHeuristic(true);
 			g_lm_heur = new LandmarksCountHeuristic(
 			*g_lgraph, *engine, landmarks_preferred_operators, g_ff_heur);
 			engine->add_heuristic(g_lm_heur, landmarks_heuristic,
@@ -210,10 +237,19 @@ int main(int argc, const char **argv) {
 		}
 		if(ff_heuristic || ff_preferred_operators) {
 			if(!g_ff_heur)
-			g_ff_heur = new FFHeuristic;
+			g_ff_heur = new FFHeuristic(true);
 			engine->add_heuristic(g_ff_heur, ff_heuristic,
 					  ff_preferred_operators);
 		}
+		if(temporal_heuristic || temporal_preferred_operators) {
+			// Shares the unary operators compiled by the FF heuristic
+			if(!g_ff_heur)
+			g_ff_heur = new FFHeuristic(true);
+			if(!temporal_heur)
+			temporal_heur = new TemporalHeuristic(*g_ff_heur, temporal_preferred_operators, true);
+			engine->add_heuristic(temporal_heur, temporal_heuristic,
+					  temporal_preferred_operators);
+		}
 
 		// Search
 		times(&search_start);
@@ -243,6 +279,7 @@ int main(int argc, const char **argv) {
 		if(wastar_weight <= 10) { // make search less greedy
 			ff_preferred_operators = false;
 			landmarks_preferred_operators = false;
+			temporal_preferred_operators = false;
 		}
 
 		// If the heuristic weight was already 0, we can only search for better solutions
@@ -342,7 +379,7 @@ float save_plan(const vector<const Operator *> &plan, const float cost, const st
 		    		ss2 >> aux2;
 		    		shared_str = shared_str + "0 " + aux1 + " " + aux2 + ")";
 
-		    		if(plan[i]->get_name().find("_start") != string::npos) {
+		    		if(plan[i]->is_start_snap()) {
 						/*for(int k = 0; k < blocked_vars_info[i].size(); k++) {
 							if((blocked_vars_info[i][k].var == var) && (blocked_vars_info[i][k].time_set == action_init_time)) {
 								block_var_duration = blocked_vars_info[i][k].time_freed - action_init_time;
@@ -388,7 +425,7 @@ float save_plan(const vector<const Operator *> &plan, const float cost, const st
 		    		shared_str = shared_str + "1 " + aux1 + " " + aux2 + " " + aux3 + ")";
 
 		    		if(is_temporal){
-						if(plan[i]->get_name().find("_start") != string::npos) {
+						if(plan[i]->is_start_snap()) {
 							/* for(int k = 0; k < blocked_vars_info[i].size(); k++) {
 								if((blocked_vars_info[i][k].var == var) && (blocked_vars_info[i][k].time_set == action_init_time)) {
 									block_var_duration = blocked_vars_info[i][k].time_freed - action_init_time;
@@ -406,7 +443,7 @@ float save_plan(const vector<const Operator *> &plan, const float cost, const st
 		}
 
 		outfile << action_duration_time << " " << action_init_time << " " << "(" << plan[i]->get_name() << ") " << action_cost << endl;
-		if(plan[i]->get_name().find("_start") != string::npos) {
+		if(plan[i]->is_start_snap()) {
 			string print_name = plan[i]->get_name();
 			print_name.erase(print_name.find("_start"), strlen("_start"));
 			agent_outfile << fixed << setprecision(3) << setfill(' ');
@@ -602,7 +639,9 @@ void print_vars_end_state(ofstream& state_outfile, vector<int> vars_end_state, v
 
 void print_heuristics_used(bool ff_heuristic, bool ff_preferred_operators, 
 			   bool landmarks_heuristic, 
-			   bool landmarks_preferred_operators) {
+			   bool landmarks_preferred_operators,
+			   bool temporal_heuristic,
+			   bool temporal_preferred_operators) {
     cout << "Using the following heuristic(s):" << endl;
     if(ff_heuristic) {
 	cout << "FF heuristic ";
@@ -616,6 +655,12 @@ void print_heuristics_used(bool ff_heuristic, bool ff_preferred_operators,
 	    cout << "with preferred operators";
 	cout << endl;
     }
+    if(temporal_heuristic) {
+	cout << "Temporal relaxed plan heuristic ";
+	if(temporal_preferred_operators)
+	    cout << "with preferred operators";
+	cout << endl;
+    }
 }
 
 void save_plan_timelines(const vector<const Operator *> &plan, const float cost, const string& filename,
@@ -37,6 +37,10 @@
 #include <cassert>
 #include<sstream>
 #include <algorithm>
+#include <unordered_map>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
 using namespace std;
 
 State::State(istream &in) {
@@ -62,59 +66,106 @@ State::State(istream &in) {
     g_current_time_value = 0;
     g_time_value = 0;
     reached_lms_cost = 0;
+    needed_lms_cost = 0;
+    missing_goals = 0;
 }
 
-void State::update_reached_lms(const Operator &op) {
-    if(g_lgraph == NULL)
-	return;
-    for(int j = 0; j < op.get_pre_post().size(); j++) {
-	const PrePost &pre_post = op.get_pre_post()[j];
-	// Test whether this effect got applied (it may have been conditional)
-	if((*this)[pre_post.var] == pre_post.post) {
-	    const LandmarkNode* node_p = 
-		g_lgraph->landmark_reached(make_pair(pre_post.var, pre_post.post));
-	    if(node_p != 0) {
-		if(reached_lms.find(node_p) == reached_lms.end()) {
-		    //cout << endl << "New LM reached! +++++++ ";
-		    //g_lgraph->dump_node(node_p);
-		    // Only add leaves of landmark graph to reached
-		    const LandmarkNode& node = *node_p;
-		    if(landmark_is_leaf(node, reached_lms)) { 
-			//cout << "inserting new LM into reached." << endl;
-			reached_lms.insert(node_p);
-			reached_lms_cost += node_p->min_cost;
-		    } 
-		    //else
-		    //cout << "not inserting into reached, has parents" << endl;
-		}
+// Goal value of each variable, -1 if it has none
+static vector<int> goal_value_of_var;
+
+void State::reach_landmarks(vector<const LandmarkNode *> &candidates,
+			    vector<const LandmarkNode *> &changed) {
+    // Adds the candidates that are true and whose parents are all reached,
+    // then the children of the added ones, until nothing changes. The
+    // added landmarks and their parents are appended to changed.
+    while(!candidates.empty()) {
+	const LandmarkNode *node = candidates.back();
+	candidates.pop_back();
+	// Only add leaves of landmark graph to reached
+	if(lm_leaves.find(node) == lm_leaves.end() || !node->is_true_in_state(*this))
+	    continue;
+	reached_lms.insert(node);
+	reached_lms_cost += node->min_cost;
+	lm_leaves.erase(node);
+	changed.push_back(node);
+	hash_map<LandmarkNode*, edge_type, hash_pointer>::const_iterator it;
+	for(it = node->parents.begin(); it != node->parents.end(); ++it)
+	    changed.push_back(it->first);
+	for(it = node->children.begin(); it != node->children.end(); ++it) {
+	    const LandmarkNode *child = it->first;
+	    if(reached_lms.find(child) == reached_lms.end() &&
+	       landmark_is_leaf(*child, reached_lms)) {
+		lm_leaves.insert(child);
+		candidates.push_back(child);
 	    }
 	}
     }
-    const set<LandmarkNode*>& nodes = g_lgraph->get_nodes();
-    set<LandmarkNode*>::const_iterator it = nodes.begin();
-    for(; it != nodes.end(); ++it) {
-	const LandmarkNode* node = *it;
-	for(int i = 0; i < node->vars.size(); i++) {
-	    if((*this)[node->vars[i]] == node->vals[i]) {
-		if(reached_lms.find(node) == reached_lms.end()) {
-		    // cout << "New LM reached by axioms: "; g_lgraph->dump_node(node);
-		    if(landmark_is_leaf(*node, reached_lms)) { 
-			// cout << "inserting new LM into reached. (2)" << endl;
-			reached_lms.insert(node);  
-			reached_lms_cost += node->min_cost;
-		    } 
-		    // else
-			// cout << "not inserting into reached, has parents" << endl;
-		}
-	    }
+}
+
+void State::update_needed_landmark(const LandmarkNode *node) {
+    // Same condition as in get_needed_landmarks
+    bool needed = reached_lms.find(node) != reached_lms.end() &&
+	!node->is_true_in_state(*this) &&
+	(node->is_goal() || check_lost_landmark_children_needed_again(*node));
+    bool was_needed = needed_lms.find(node) != needed_lms.end();
+    if(needed && !was_needed) {
+	needed_lms.insert(node);
+	needed_lms_cost += node->min_cost;
+    } else if(!needed && was_needed) {
+	needed_lms.erase(node);
+	needed_lms_cost -= node->min_cost;
+    }
+}
+
+void State::update_reached_lms(const State &predecessor) {
+    // Called once the operator and axioms have been applied. Apart from the
+    // successors of the initial state, whose reached landmarks are only the
+    // roots, the landmarks that can become reached are those of the facts
+    // that changed (effects or axioms) and the children of new landmarks.
+    if(g_lgraph == NULL)
+	return;
+    static vector<const LandmarkNode *> candidates, changed;
+    candidates.clear();
+    changed.clear();
+    bool all_nodes = predecessor.applied_actions == 0;
+    if(all_nodes) {
+	const set<LandmarkNode*>& nodes = g_lgraph->get_nodes();
+	candidates.insert(candidates.end(), nodes.rbegin(), nodes.rend());
+    }
+    for(int var = vars.size() - 1; var >= 0; var--) {
+	int old_val = predecessor.vars[var], new_val = vars[var];
+	if(new_val == old_val)
+	    continue;
+	if(goal_value_of_var[var] != -1) {
+	    if(old_val == goal_value_of_var[var])
+		missing_goals++;
+	    if(new_val == goal_value_of_var[var])
+		missing_goals--;
+	}
+	if(old_val != -1) {
+	    const vector<const LandmarkNode*> &nodes = g_lgraph->get_nodes_with_fact(var, old_val);
+	    changed.insert(changed.end(), nodes.begin(), nodes.end());
+	}
+	if(new_val != -1) {
+	    const vector<const LandmarkNode*> &nodes = g_lgraph->get_nodes_with_fact(var, new_val);
+	    changed.insert(changed.end(), nodes.begin(), nodes.end());
+	    if(!all_nodes)
+		candidates.insert(candidates.end(), nodes.begin(), nodes.end());
 	}
     }
+    reach_landmarks(candidates, changed);
+    for(int i = 0; i < changed.size(); i++)
+	update_needed_landmark(changed[i]);
 }
 
 void State::change_ancestor(const State &new_predecessor, const Operator &new_op) {
     reached_lms = new_predecessor.reached_lms; // Can this be a problem?
     reached_lms_cost = new_predecessor.reached_lms_cost;
-    update_reached_lms(new_op);
+    lm_leaves = new_predecessor.lm_leaves;
+    needed_lms = new_predecessor.needed_lms;
+    needed_lms_cost = new_predecessor.needed_lms_cost;
+    missing_goals = new_predecessor.missing_goals;
+    update_reached_lms(new_predecessor);
 
 	float op_duration = 0;
 	float op_end_time = 0;
@@ -129,43 +180,34 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 		if(use_hard_temporal_constraints)
 		{
 	    	// Check if the time has to be updated because of external constraints
-			for(int k = 0; k < g_shared_vars_timed_values.size(); k++)
+			const vector<int> &shared_effects = new_op.get_shared_effects();
+			for(int e = 0; e < shared_effects.size(); e++)
 			{
-				vector<PrePost>::const_iterator it_pp = new_op.get_pre_post().begin();
-				for(; it_pp != new_op.get_pre_post().end(); ++it_pp)
+				const PrePost &pp = new_op.get_pre_post()[shared_effects[e]];
+				const SharedVarTimeline *timeline = get_shared_var_timeline(pp.var);
+				if(timeline == NULL)
+					continue;
+
+				// Search constraint value at that time
+				int j = timeline->find_window(op_end_time);
+				if(j == -1)
+					continue;
+				if((timeline->values[j] != pp.pre) &&
+						(pp.pre != -1) &&
+						(timeline->values[j] != -1))
 				{
-					PrePost pp = *it_pp;
-					if(pp.var == g_shared_vars_timed_values[k]->first)
-					{
-						// Search constraint value at that time
-						for(int j = 0; j < (g_shared_vars_timed_values[k]->second->size() - 1); j++)
-						{
-							if((op_end_time > (*(g_shared_vars_timed_values[k]->second))[j]->second) &&
-									(op_end_time <= (*(g_shared_vars_timed_values[k]->second))[j + 1]->second))
-							{
-								if(((*(g_shared_vars_timed_values[k]->second))[j]->first != pp.pre) &&
-										(pp.pre != -1) &&
-										((*(g_shared_vars_timed_values[k]->second))[j]->first != -1)
-								  )
-								{
-									// Set the new time value to a time window when the action can be executed
-									float new_time = get_new_time_window(new_op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-									g_current_time_value = new_time;
-									op_start_time = new_time;
-									op_end_time = g_current_time_value + 0.01;
-									break;
-								} else if(op_duration > (((*(g_shared_vars_timed_values[k]->second))[j + 1]->second) - (this->get_g_current_time_value())))
-								{
-									// Set the new time value to a time window when the action can be executed
-									float new_time = get_new_time_window(new_op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-									g_current_time_value = new_time;
-									op_start_time = new_time;
-									op_end_time = g_current_time_value + 0.01;
-									break;
-								}
-							}
-						}
-					}
+					// Set the new time value to a time window when the action can be executed
+					float new_time = get_new_time_window(new_op, this, op_duration, *timeline, pp.pre);
+					g_current_time_value = new_time;
+					op_start_time = new_time;
+					op_end_time = g_current_time_value + 0.01;
+				} else if(op_duration > ((timeline->times[j + 1]) - (this->get_g_current_time_value())))
+				{
+					// Set the new time value to a time window when the action can be executed
+					float new_time = get_new_time_window(new_op, this, op_duration, *timeline, pp.pre);
+					g_current_time_value = new_time;
+					op_start_time = new_time;
+					op_end_time = g_current_time_value + 0.01;
 				}
 			}
 		}
@@ -173,31 +215,26 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
     } else {
 
 		// Get action duration
-		if(new_op.get_name().find("_start") != string::npos){
+		if(new_op.is_start_snap()){
 			// Get the duration calculating the costfrom the current state
-			vector<PrePost>::const_iterator it_pp = new_op.get_pre_post().begin();
-			for(; it_pp != new_op.get_pre_post().end(); ++it_pp) {
-				PrePost pp = *it_pp;
-				if(g_variable_name[pp.var] == total_time_var)
+			const PrePost *dur = new_op.get_duration_effect();
+			if(dur != 0)
+			{
+				if(dur->have_runtime_cost_effect)
 				{
-					if(pp.have_runtime_cost_effect)
-					{
-						op_duration = new_predecessor.calculate_runtime_efect<float>(pp.runtime_cost_effect);
-						if(op_duration == 0)
-							op_duration = 0.01;
-					}else if (pp.have_module_cost_effect) {
-						cout << pp.runtime_cost_effect << endl;
-						op_duration = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pp.runtime_cost_effect]);
-						if(op_duration == 0)
-							op_duration = 0.01;
-
-					}else{
-						op_duration = pp.f_cost;
-						if(op_duration == 0)
-							op_duration = 0.01;
-					}
+					op_duration = new_predecessor.calculate_runtime_efect<float>(dur->runtime_effect);
+					if(op_duration == 0)
+						op_duration = 0.01;
+				}else if (dur->have_module_cost_effect) {
+					cout << dur->runtime_cost_effect << endl;
+					op_duration = g_ext_func_manager.compute_function_at(dur->ext_func, new_predecessor.numeric_vars_val);
+					if(op_duration == 0)
+						op_duration = 0.01;
 
-					break;
+				}else{
+					op_duration = dur->f_cost;
+					if(op_duration == 0)
+						op_duration = 0.01;
 				}
 			}
 		} else{
@@ -208,7 +245,7 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 					vector<PrePost*>::const_iterator it_fc = (*it_ra_const).functional_costs.begin();
 					for(; (it_fc != (*it_ra_const).functional_costs.end()) && (op_duration == 0); ++it_fc) {
 						PrePost* pp = *it_fc;
-						if(g_variable_name[pp->var] == total_time_var)
+						if(pp->var == g_total_time_var)
 						{
 							op_duration = pp->f_cost;
 						}
@@ -218,7 +255,7 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 		}
 
 		op_end_time = new_predecessor.get_g_current_time_value() + 0.01;
-		if(new_op.get_name().find("_end") != string::npos)
+		if(new_op.is_end_snap())
 		{
 			vector<runn_action>::const_iterator it_ra = new_predecessor.running_actions.begin();
 			for(; it_ra != new_predecessor.running_actions.end();)
@@ -238,46 +275,37 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 		if(use_hard_temporal_constraints)
 		{
 			// Check if the time has to be updated because of external constraints
-			for(int k = 0; k < g_shared_vars_timed_values.size(); k++)
+			const vector<int> &shared_effects = new_op.get_shared_effects();
+			for(int e = 0; e < shared_effects.size(); e++)
 			{
-				vector<PrePost>::const_iterator it_pp = new_op.get_pre_post().begin();
-				for(; it_pp != new_op.get_pre_post().end(); ++it_pp)
+				const PrePost &pp = new_op.get_pre_post()[shared_effects[e]];
+				const SharedVarTimeline *timeline = get_shared_var_timeline(pp.var);
+				if(timeline == NULL)
+					continue;
+
+				// Search constraint value at that time
+				int j = timeline->find_window(op_end_time);
+				if(j == -1)
+					continue;
+				if((timeline->values[j] != pp.pre) &&
+						(pp.pre != -1) &&
+						(timeline->values[j] != -1))
 				{
-					PrePost pp = *it_pp;
-					if(pp.var == g_shared_vars_timed_values[k]->first)
-					{
-						// Search constraint value at that time
-						for(int j = 0; j < (g_shared_vars_timed_values[k]->second->size() - 1); j++)
-						{
-							if((op_end_time > (*(g_shared_vars_timed_values[k]->second))[j]->second) &&
-									(op_end_time <= (*(g_shared_vars_timed_values[k]->second))[j + 1]->second))
-							{
-								if(((*(g_shared_vars_timed_values[k]->second))[j]->first != pp.pre) &&
-										(pp.pre != -1) &&
-										((*(g_shared_vars_timed_values[k]->second))[j]->first != -1)
-								  )
-								{
-									if ((new_op.get_name().find("_start") != string::npos) && (new_predecessor.running_actions.size() == 0)){
-										// Set the new time value to a time window when the action can be executed
-										float new_time = get_new_time_window(new_op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-										g_current_time_value = new_time;
-										op_start_time = new_time;
-										op_end_time = g_current_time_value + 0.01;
-										break;
-									}
-								} else if(op_duration > (((*(g_shared_vars_timed_values[k]->second))[j + 1]->second) - (this->get_g_current_time_value())))
-								{
-									if ((new_op.get_name().find("_start") != string::npos) && (new_predecessor.running_actions.size() == 0)){
-										// Set the new time value to a time window when the action can be executed
-										float new_time = get_new_time_window(new_op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-										g_current_time_value = new_time;
-										op_start_time = new_time;
-										op_end_time = g_current_time_value + 0.01;
-										break;
-									}
-								}
-							}
-						}
+					if ((new_op.is_start_snap()) && (new_predecessor.running_actions.size() == 0)){
+						// Set the new time value to a time window when the action can be executed
+						float new_time = get_new_time_window(new_op, this, op_duration, *timeline, pp.pre);
+						g_current_time_value = new_time;
+						op_start_time = new_time;
+						op_end_time = g_current_time_value + 0.01;
+					}
+				} else if(op_duration > ((timeline->times[j + 1]) - (this->get_g_current_time_value())))
+				{
+					if ((new_op.is_start_snap()) && (new_predecessor.running_actions.size() == 0)){
+						// Set the new time value to a time window when the action can be executed
+						float new_time = get_new_time_window(new_op, this, op_duration, *timeline, pp.pre);
+						g_current_time_value = new_time;
+						op_start_time = new_time;
+						op_end_time = g_current_time_value + 0.01;
 					}
 				}
 			}
@@ -315,7 +343,7 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 						}
 					}
 					if(value_changed) {
-						if(new_op.get_name().find("_start") != string::npos)
+						if(new_op.is_start_snap())
 						{
 							op_start_time = min_start_action_time;
 							op_end_time = min_start_action_time + op_duration;
@@ -358,7 +386,7 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 						}
 					}
 					if(value_changed) {
-						if(new_op.get_name().find("_start") != string::npos)
+						if(new_op.is_start_snap())
 						{
 							op_start_time = min_start_action_time;
 							op_end_time = min_start_action_time + op_duration;
@@ -385,7 +413,7 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 		}
 
 		g_time_value = op_duration;
-		if(new_op.get_name().find("_start") != string::npos){
+		if(new_op.is_start_snap()){
 			running_actions.push_back(*(new(runn_action)));
 			running_actions.back().non_temporal_action_name = new_op.get_non_temporal_action_name();
 			running_actions.back().time_start = op_start_time;
@@ -404,15 +432,17 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 					pre_post->runtime_cost_effect = new_op.get_pre_post()[i].runtime_cost_effect;
 				else
 					pre_post->runtime_cost_effect = "";
+				pre_post->ext_func = new_op.get_pre_post()[i].ext_func;
+				pre_post->runtime_effect = new_op.get_pre_post()[i].runtime_effect;
 
 				if((pre_post->pre == -2) || (pre_post->pre == -3) || (pre_post->pre == -4))
 				{
 					if(pre_post->have_runtime_cost_effect)
 					{
-						pre_post->f_cost = new_predecessor.calculate_runtime_efect<float>(pre_post->runtime_cost_effect);
+						pre_post->f_cost = new_predecessor.calculate_runtime_efect<float>(pre_post->runtime_effect);
 						running_actions.back().functional_costs.push_back(pre_post);
 					} else if(pre_post->have_module_cost_effect) {
-						pre_post->f_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post->runtime_cost_effect]);
+						pre_post->f_cost = g_ext_func_manager.compute_function_at(pre_post->ext_func, new_predecessor.numeric_vars_val);
 						running_actions.back().functional_costs.push_back(pre_post);
 					}
 					else
@@ -435,45 +465,30 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 		}
 
 		// If the action added is an start action, we must remove the previous one blocked variables
-		vector<blocked_var>::iterator it_bv = this->blocked_vars.begin();
-		for(; it_bv != this->blocked_vars.end();)
-		{
-			if(it_bv->non_temporal_action_name == new_op.get_non_temporal_action_name())
-				it_bv = this->blocked_vars.erase(it_bv);
-			else
-				it_bv++;
-		}
+		remove_blocked_vars(new_op.get_non_temporal_action_name());
 
 		// Now update the locked variables, the operation is different for start and end actions
-		if(new_op.get_name().find("_start") != string::npos)
+		if(new_op.is_start_snap())
 		{
 			// Add blocks to variables
 			vector<PrePost>::const_iterator it_pb = new_op.get_pre_block().begin();
 			for(; it_pb != new_op.get_pre_block().end(); it_pb++ )
 			{
-				blocked_var* new_block = new(blocked_var);
-				new_block->var = it_pb-> var;
-				new_block->val = it_pb->post;
-				new_block->block_type = it_pb->pre;
-				new_block->time_set = op_start_time;
-				new_block->time_freed = op_start_time + op_duration;
-				new_block->non_temporal_action_name = new_op.get_non_temporal_action_name();
-
-				blocked_vars.push_back(*new_block);
+				blocked_var new_block;
+				new_block.var = it_pb-> var;
+				new_block.val = it_pb->post;
+				new_block.block_type = it_pb->pre;
+				new_block.time_set = op_start_time;
+				new_block.time_freed = op_start_time + op_duration;
+				new_block.non_temporal_action_name = new_op.get_non_temporal_action_name();
+
+				add_blocked_var(new_block);
 			}
 		}
 		else
 		{
 			// Remove blocks to variables
-			vector<blocked_var>::iterator it_pb = this->blocked_vars.begin();
-			for(; it_pb != this->blocked_vars.end();)
-			{
-				if(it_pb->non_temporal_action_name == new_op.get_non_temporal_action_name())
-				{
-					it_pb = this->blocked_vars.erase(it_pb);
-				} else
-					it_pb++;
-			}
+			remove_blocked_vars(new_op.get_non_temporal_action_name());
 		}
 
 	    // Copy the values for the already attained temporal goals
@@ -528,12 +543,12 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 		this->numeric_vars_val.push_back(*it_f);
 	}
     // Only truly update numeric values if the action is an end action
-    for(int i = 0; (i < new_op.get_pre_post().size()) && ((new_op.get_name().find("_end") != string::npos) || (is_temporal)) ; i++) {
+    for(int i = 0; (i < new_op.get_pre_post().size()) && ((new_op.is_end_snap()) || (is_temporal)) ; i++) {
 		const PrePost &pre_post = new_op.get_pre_post()[i];
 		if(pre_post.does_fire(new_predecessor)){
 			switch(pre_post.pre){
 			case -2:{
-				if(g_variable_name[pre_post.var] == total_time_var) {
+				if(pre_post.var == g_total_time_var) {
 					numeric_vars_val[pre_post.var] = this->get_g_current_time_value();
 				}
 				else {
@@ -544,11 +559,11 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 						cal_cost = pre_post.f_cost;
 					} else if (pre_post.have_module_cost_effect) {
 						// cout << pre_post.runtime_cost_effect << endl;
-						cal_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]);
+						cal_cost = g_ext_func_manager.compute_function_at(pre_post.ext_func, new_predecessor.numeric_vars_val);
 						numeric_vars_val[pre_post.var] = new_predecessor.numeric_vars_val[pre_post.var] + cal_cost;
 					}
 					else{
-						cal_cost = new_predecessor.calculate_runtime_efect<float>(pre_post.runtime_cost_effect);
+						cal_cost = new_predecessor.calculate_runtime_efect<float>(pre_post.runtime_effect);
 						numeric_vars_val[pre_post.var] = new_predecessor.numeric_vars_val[pre_post.var] + cal_cost;
 					}
 				}
@@ -561,11 +576,11 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 					numeric_vars_val[pre_post.var] = new_predecessor.numeric_vars_val[pre_post.var] - pre_post.f_cost;
 				}
 				else if (pre_post.have_module_cost_effect) {
-					float cal_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]);
+					float cal_cost = g_ext_func_manager.compute_function_at(pre_post.ext_func, new_predecessor.numeric_vars_val);
 					numeric_vars_val[pre_post.var] = new_predecessor.numeric_vars_val[pre_post.var] - cal_cost;
 				}
 				else{
-					float cal_cost = new_predecessor.calculate_runtime_efect<float>(pre_post.runtime_cost_effect);
+					float cal_cost = new_predecessor.calculate_runtime_efect<float>(pre_post.runtime_effect);
 					numeric_vars_val[pre_post.var] = new_predecessor.numeric_vars_val[pre_post.var] - cal_cost;
 				}
 				break;
@@ -576,11 +591,11 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 					numeric_vars_val[pre_post.var] = pre_post.f_cost;
 				else if (pre_post.have_module_cost_effect) {
 					// cout << pre_post.runtime_cost_effect << endl;
-					float cal_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]);
+					float cal_cost = g_ext_func_manager.compute_function_at(pre_post.ext_func, new_predecessor.numeric_vars_val);
 					numeric_vars_val[pre_post.var] = cal_cost;
 				}
 				else{
-					float cal_cost = new_predecessor.calculate_runtime_efect<float>(pre_post.runtime_cost_effect);
+					float cal_cost = new_predecessor.calculate_runtime_efect<float>(pre_post.runtime_effect);
 					numeric_vars_val[pre_post.var] = cal_cost;
 				}
 				break;
@@ -605,10 +620,10 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
         	g_value = new_predecessor.get_g_value() + new_op.get_cost();
 		else if (new_op.get_have_module_cost()) {
 			// cout << new_op.get_runtime_cost() << endl;
-			g_value =  new_predecessor.get_g_value() + g_ext_func_manager.compute_function(g_instantiated_funcs_dict[new_op.get_runtime_cost()]);
+			g_value =  new_predecessor.get_g_value() + g_ext_func_manager.compute_function_at(new_op.get_runtime_cost_func(), numeric_vars_val);
 		}
     	else {
-    		g_value = new_predecessor.get_g_value() + this->calculate_runtime_efect<float>(new_op.get_runtime_cost()) + 1;
+    		g_value = new_predecessor.get_g_value() + this->calculate_runtime_efect<float>(new_op.get_compiled_runtime_cost()) + 1;
     	}
     if (g_use_metric) // if using action costs, all costs have been increased by 1
 		g_value = g_value - 1;
@@ -649,7 +664,9 @@ void State::change_ancestor(const State &new_predecessor, const Operator &new_op
 
 State::State(const State &predecessor, const Operator &op)
     : vars(predecessor.vars), numeric_vars_val(predecessor.numeric_vars_val),
-	  reached_lms(predecessor.reached_lms), reached_lms_cost(predecessor.reached_lms_cost) {
+	  reached_lms(predecessor.reached_lms), reached_lms_cost(predecessor.reached_lms_cost),
+	  lm_leaves(predecessor.lm_leaves), needed_lms(predecessor.needed_lms),
+	  needed_lms_cost(predecessor.needed_lms_cost), missing_goals(predecessor.missing_goals) {
     assert(!op.is_axiom());
 
 	float op_duration = 0;
@@ -658,31 +675,26 @@ State::State(const State &predecessor, const Operator &op)
 
 	if(is_temporal){
 		// Get action duration
-		if(op.get_name().find("_start") != string::npos){
+		if(op.is_start_snap()){
 			// Get the duration calculating the costfrom the current state
-			vector<PrePost>::const_iterator it_pp = op.get_pre_post().begin();
-			for(; it_pp != op.get_pre_post().end(); ++it_pp) {
-				PrePost pp = *it_pp;
-				if(g_variable_name[pp.var] == total_time_var)
+			const PrePost *dur = op.get_duration_effect();
+			if(dur != 0)
+			{
+				if(dur->have_runtime_cost_effect)
 				{
-					if(pp.have_runtime_cost_effect)
-					{
-						// cout << pp.runtime_cost_effect << endl;
-						op_duration = predecessor.calculate_runtime_efect<float>(pp.runtime_cost_effect);
-						if(op_duration == 0)
-							op_duration = 0.01;
-					} else if(pp.have_module_cost_effect) {
-						// cout << pp.runtime_cost_effect << endl;
-						op_duration = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pp.runtime_cost_effect]);
-						if(op_duration == 0)
-							op_duration = 0.01;
-					} else {
-						op_duration = pp.f_cost;
-						if(op_duration == 0)
-							op_duration = 0.01;
-					}
-
-					break;
+					// cout << dur->runtime_cost_effect << endl;
+					op_duration = predecessor.calculate_runtime_efect<float>(dur->runtime_effect);
+					if(op_duration == 0)
+						op_duration = 0.01;
+				} else if(dur->have_module_cost_effect) {
+					// cout << dur->runtime_cost_effect << endl;
+					op_duration = g_ext_func_manager.compute_function_at(dur->ext_func, predecessor.numeric_vars_val);
+					if(op_duration == 0)
+						op_duration = 0.01;
+				} else {
+					op_duration = dur->f_cost;
+					if(op_duration == 0)
+						op_duration = 0.01;
 				}
 			}
 		} else {
@@ -693,7 +705,7 @@ State::State(const State &predecessor, const Operator &op)
 					vector<PrePost*>::const_iterator it_fc = (*it_ra_const).functional_costs.begin();
 					for(; (it_fc != (*it_ra_const).functional_costs.end()) && (op_duration == 0); ++it_fc) {
 						PrePost* pp = *it_fc;
-						if(g_variable_name[pp->var] == total_time_var)
+						if(pp->var == g_total_time_var)
 						{
 							op_duration = pp->f_cost;
 						}
@@ -704,7 +716,7 @@ State::State(const State &predecessor, const Operator &op)
 
 
 		op_end_time = predecessor.get_g_current_time_value() + 0.01;
-		if(op.get_name().find("_end") != string::npos)
+		if(op.is_end_snap())
 		{
 			vector<runn_action>::const_iterator it_ra = predecessor.running_actions.begin();
 			for(; it_ra != predecessor.running_actions.end();)
@@ -724,46 +736,37 @@ State::State(const State &predecessor, const Operator &op)
 		// Check if the time has to be updated because of external constraints
 		if(use_hard_temporal_constraints)
 		{
-			for(int k = 0; k < g_shared_vars_timed_values.size(); k++)
+			const vector<int> &shared_effects = op.get_shared_effects();
+			for(int e = 0; e < shared_effects.size(); e++)
 			{
-				vector<PrePost>::const_iterator it_pp = op.get_pre_post().begin();
-				for(; it_pp != op.get_pre_post().end(); ++it_pp)
+				const PrePost &pp = op.get_pre_post()[shared_effects[e]];
+				const SharedVarTimeline *timeline = get_shared_var_timeline(pp.var);
+				if(timeline == NULL)
+					continue;
+
+				// Search constraint value at that time
+				int j = timeline->find_window(op_end_time);
+				if(j == -1)
+					continue;
+				if((timeline->values[j] != pp.pre) &&
+						(pp.pre != -1) &&
+						(timeline->values[j] != -1))
 				{
-					PrePost pp = *it_pp;
-					if(pp.var == g_shared_vars_timed_values[k]->first)
-					{
-						// Search constraint value at that time
-						for(int j = 0; j < (g_shared_vars_timed_values[k]->second->size() - 1); j++)
-						{
-							if((op_end_time > (*(g_shared_vars_timed_values[k]->second))[j]->second) &&
-									(op_end_time <= (*(g_shared_vars_timed_values[k]->second))[j + 1]->second))
-							{
-								if(((*(g_shared_vars_timed_values[k]->second))[j]->first != pp.pre) &&
-										(pp.pre != -1) &&
-										((*(g_shared_vars_timed_values[k]->second))[j]->first != -1)
-								  )
-								{
-									if ((op.get_name().find("_start") != string::npos) && (predecessor.running_actions.size() == 0)){
-										// Set the new time value to a time window when the action can be executed
-										float new_time = get_new_time_window(op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-										g_current_time_value = new_time;
-										op_start_time = new_time;
-										op_end_time = g_current_time_value + 0.01;
-										break;
-									}
-								} else if(op_duration > (((*(g_shared_vars_timed_values[k]->second))[j + 1]->second) - (this->get_g_current_time_value())))
-								{
-									if ((op.get_name().find("_start") != string::npos) && (predecessor.running_actions.size() == 0)){
-										// Set the new time value to a time window when the action can be executed
-										float new_time = get_new_time_window(op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-										g_current_time_value = new_time;
-										op_start_time = new_time;
-										op_end_time = g_current_time_value + 0.01;
-										break;
-									}
-								}
-							}
-						}
+					if ((op.is_start_snap()) && (predecessor.running_actions.size() == 0)){
+						// Set the new time value to a time window when the action can be executed
+						float new_time = get_new_time_window(op, this, op_duration, *timeline, pp.pre);
+						g_current_time_value = new_time;
+						op_start_time = new_time;
+						op_end_time = g_current_time_value + 0.01;
+					}
+				} else if(op_duration > ((timeline->times[j + 1]) - (this->get_g_current_time_value())))
+				{
+					if ((op.is_start_snap()) && (predecessor.running_actions.size() == 0)){
+						// Set the new time value to a time window when the action can be executed
+						float new_time = get_new_time_window(op, this, op_duration, *timeline, pp.pre);
+						g_current_time_value = new_time;
+						op_start_time = new_time;
+						op_end_time = g_current_time_value + 0.01;
 					}
 				}
 			}
@@ -801,7 +804,7 @@ State::State(const State &predecessor, const Operator &op)
 						}
 					}
 					if(value_changed) {
-						if(op.get_name().find("_start") != string::npos)
+						if(op.is_start_snap())
 						{
 							op_start_time = min_start_action_time;
 							op_end_time = min_start_action_time + op_duration;
@@ -844,7 +847,7 @@ State::State(const State &predecessor, const Operator &op)
 									}
 								}
 								if(value_changed) {
-									if(op.get_name().find("_start") != string::npos)
+									if(op.is_start_snap())
 									{
 										op_start_time = min_start_action_time;
 										op_end_time = min_start_action_time + op_duration;
@@ -867,7 +870,7 @@ State::State(const State &predecessor, const Operator &op)
 		}
 
 		g_time_value = op_duration;
-		if(op.get_name().find("_start") != string::npos)
+		if(op.is_start_snap())
 		{
 			running_actions.push_back(*(new(runn_action)));
 			running_actions.back().non_temporal_action_name = op.get_non_temporal_action_name();
@@ -888,17 +891,19 @@ State::State(const State &predecessor, const Operator &op)
 					pre_post->runtime_cost_effect = op.get_pre_post()[i].runtime_cost_effect;
 				else
 					pre_post->runtime_cost_effect = "";
+				pre_post->ext_func = op.get_pre_post()[i].ext_func;
+				pre_post->runtime_effect = op.get_pre_post()[i].runtime_effect;
 
 				if((pre_post->pre == -2) || (pre_post->pre == -3) || (pre_post->pre == -4))
 				{
 					if(pre_post->have_runtime_cost_effect)
 					{
-						pre_post->f_cost = predecessor.calculate_runtime_efect<float>(pre_post->runtime_cost_effect);
+						pre_post->f_cost = predecessor.calculate_runtime_efect<float>(pre_post->runtime_effect);
 						running_actions.back().functional_costs.push_back(pre_post);
 					} else if(pre_post->have_module_cost_effect)
 					{
 						// cout << pre_post->runtime_cost_effect << endl;
-						pre_post->f_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post->runtime_cost_effect]);
+						pre_post->f_cost = g_ext_func_manager.compute_function_at(pre_post->ext_func, predecessor.numeric_vars_val);
 						running_actions.back().functional_costs.push_back(pre_post);
 					}else {
 						running_actions.back().functional_costs.push_back(pre_post);
@@ -920,42 +925,30 @@ State::State(const State &predecessor, const Operator &op)
 		}
 
 		// Copy locked variables
-		vector<blocked_var>::const_iterator it_bv = predecessor.blocked_vars.begin();
-		for(; it_bv != predecessor.blocked_vars.end(); it_bv++)
-		{
-			this->blocked_vars.push_back(*it_bv);
-		}
+		blocked_vars = predecessor.blocked_vars;
 
 		// Now update the locked variables, the operation is different for start and end actions
-		if(op.get_name().find("_start") != string::npos)
+		if(op.is_start_snap())
 		{
 			// Add blocks to variables
 			vector<PrePost>::const_iterator it_pb = op.get_pre_block().begin();
 			for(; it_pb != op.get_pre_block().end(); it_pb++ )
 			{
-				blocked_var* new_block = new(blocked_var);
-				new_block->var = it_pb-> var;
-				new_block->val = it_pb->post;
-				new_block->block_type = it_pb->pre;
-				new_block->time_set = op_start_time;
-				new_block->time_freed = op_start_time + op_duration;
-				new_block->non_temporal_action_name = op.get_non_temporal_action_name();
-
-				blocked_vars.push_back(*new_block);
+				blocked_var new_block;
+				new_block.var = it_pb-> var;
+				new_block.val = it_pb->post;
+				new_block.block_type = it_pb->pre;
+				new_block.time_set = op_start_time;
+				new_block.time_freed = op_start_time + op_duration;
+				new_block.non_temporal_action_name = op.get_non_temporal_action_name();
+
+				add_blocked_var(new_block);
 			}
 		}
 		else
 		{
 			// Remove blocks to variables
-			vector<blocked_var>::iterator it_pb = this->blocked_vars.begin();
-			for(; it_pb != this->blocked_vars.end();)
-			{
-				if(it_pb->non_temporal_action_name == op.get_non_temporal_action_name())
-				{
-					it_pb = this->blocked_vars.erase(it_pb);
-				} else
-					it_pb++;
-			}
+			remove_blocked_vars(op.get_non_temporal_action_name());
 		}
 
 	    // Copy the values for the already attained temporal goals
@@ -1010,43 +1003,34 @@ State::State(const State &predecessor, const Operator &op)
 		if(use_hard_temporal_constraints)
 		{
 	    	// Check if the time has to be updated because of external constraints
-			for(int k = 0; k < g_shared_vars_timed_values.size(); k++)
+			const vector<int> &shared_effects = op.get_shared_effects();
+			for(int e = 0; e < shared_effects.size(); e++)
 			{
-				vector<PrePost>::const_iterator it_pp = op.get_pre_post().begin();
-				for(; it_pp != op.get_pre_post().end(); ++it_pp)
+				const PrePost &pp = op.get_pre_post()[shared_effects[e]];
+				const SharedVarTimeline *timeline = get_shared_var_timeline(pp.var);
+				if(timeline == NULL)
+					continue;
+
+				// Search constraint value at that time
+				int j = timeline->find_window(op_end_time);
+				if(j == -1)
+					continue;
+				if((timeline->values[j] != pp.pre) &&
+						(pp.pre != -1) &&
+						(timeline->values[j] != -1))
 				{
-					PrePost pp = *it_pp;
-					if(pp.var == g_shared_vars_timed_values[k]->first)
-					{
-						// Search constraint value at that time
-						for(int j = 0; j < (g_shared_vars_timed_values[k]->second->size() - 1); j++)
-						{
-							if((op_end_time > (*(g_shared_vars_timed_values[k]->second))[j]->second) &&
-									(op_end_time <= (*(g_shared_vars_timed_values[k]->second))[j + 1]->second))
-							{
-								if(((*(g_shared_vars_timed_values[k]->second))[j]->first != pp.pre) &&
-										(pp.pre != -1) &&
-										((*(g_shared_vars_timed_values[k]->second))[j]->first != -1)
-								  )
-								{
-									// Set the new time value to a time window when the action can be executed
-									float new_time = get_new_time_window(op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-									g_current_time_value = new_time;
-									op_start_time = new_time;
-									op_end_time = g_current_time_value + 0.01;
-									break;
-								} else if(op_duration > (((*(g_shared_vars_timed_values[k]->second))[j + 1]->second) - (this->get_g_current_time_value())))
-								{
-									// Set the new time value to a time window when the action can be executed
-									float new_time = get_new_time_window(op, this, op_duration, *(g_shared_vars_timed_values[k]->second), pp.pre);
-									g_current_time_value = new_time;
-									op_start_time = new_time;
-									op_end_time = g_current_time_value + 0.01;
-									break;
-								}
-							}
-						}
-					}
+					// Set the new time value to a time window when the action can be executed
+					float new_time = get_new_time_window(op, this, op_duration, *timeline, pp.pre);
+					g_current_time_value = new_time;
+					op_start_time = new_time;
+					op_end_time = g_current_time_value + 0.01;
+				} else if(op_duration > ((timeline->times[j + 1]) - (this->get_g_current_time_value())))
+				{
+					// Set the new time value to a time window when the action can be executed
+					float new_time = get_new_time_window(op, this, op_duration, *timeline, pp.pre);
+					g_current_time_value = new_time;
+					op_start_time = new_time;
+					op_end_time = g_current_time_value + 0.01;
 				}
 			}
 		}
@@ -1060,12 +1044,12 @@ State::State(const State &predecessor, const Operator &op)
     }
 
     // Only truly update numeric values if the action is an end action
-    for(int i = 0; (i < op.get_pre_post().size()) && ((op.get_name().find("_end") != string::npos) || (is_temporal)) ; i++) {
+    for(int i = 0; (i < op.get_pre_post().size()) && ((op.is_end_snap()) || (is_temporal)) ; i++) {
 		const PrePost &pre_post = op.get_pre_post()[i];
 		if(pre_post.does_fire(predecessor)){
 			switch(pre_post.pre){
 			case -2:{
-				if(g_variable_name[pre_post.var] == total_time_var) {
+				if(pre_post.var == g_total_time_var) {
 					numeric_vars_val[pre_post.var] = this->get_g_current_time_value();
 				}
 				else {
@@ -1076,11 +1060,11 @@ State::State(const State &predecessor, const Operator &op)
 						cal_cost = pre_post.f_cost;
 					} else if(pre_post.have_module_cost_effect) {
 						// cout << pre_post.runtime_cost_effect << endl;
-						cal_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]);
+						cal_cost = g_ext_func_manager.compute_function_at(pre_post.ext_func, numeric_vars_val);
 						numeric_vars_val[pre_post.var] = numeric_vars_val[pre_post.var] + cal_cost;
 					}
 					else{
-						cal_cost = this->calculate_runtime_efect<float>(pre_post.runtime_cost_effect);
+						cal_cost = this->calculate_runtime_efect<float>(pre_post.runtime_effect);
 						numeric_vars_val[pre_post.var] = numeric_vars_val[pre_post.var] + cal_cost;
 					}
 				}
@@ -1094,11 +1078,11 @@ State::State(const State &predecessor, const Operator &op)
 				}
 				else if(pre_post.have_module_cost_effect) {
 					// cout << pre_post.runtime_cost_effect << endl;
-					float cal_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]);
+					float cal_cost = g_ext_func_manager.compute_function_at(pre_post.ext_func, numeric_vars_val);
 					numeric_vars_val[pre_post.var] = numeric_vars_val[pre_post.var] - cal_cost;
 				}
 				else{
-					float cal_cost = this->calculate_runtime_efect<float>(pre_post.runtime_cost_effect);
+					float cal_cost = this->calculate_runtime_efect<float>(pre_post.runtime_effect);
 					numeric_vars_val[pre_post.var] = numeric_vars_val[pre_post.var] - cal_cost;
 				}
 				break;
@@ -1109,11 +1093,11 @@ State::State(const State &predecessor, const Operator &op)
 					numeric_vars_val[pre_post.var] = pre_post.f_cost;
 				else if(pre_post.have_module_cost_effect) {
 					// cout << pre_post.runtime_cost_effect << endl;
-					float cal_cost = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]);
+					float cal_cost = g_ext_func_manager.compute_function_at(pre_post.ext_func, numeric_vars_val);
 					numeric_vars_val[pre_post.var] = cal_cost;
 				}
 				else{
-					float cal_cost = this->calculate_runtime_efect<float>(pre_post.runtime_cost_effect);
+					float cal_cost = this->calculate_runtime_efect<float>(pre_post.runtime_effect);
 					numeric_vars_val[pre_post.var] = cal_cost;
 				}
 				break;
@@ -1127,9 +1111,9 @@ State::State(const State &predecessor, const Operator &op)
 			}
 		}
 	}
-    g_axiom_evaluator->evaluate(*this);
+    g_axiom_evaluator->evaluate(*this, predecessor);
     // Update set of reached landmarks.
-    update_reached_lms(op);
+    update_reached_lms(predecessor);
     // Update g_value
     if(g_length_metric)
     	g_value = predecessor.get_g_value() + 2;
@@ -1140,10 +1124,10 @@ State::State(const State &predecessor, const Operator &op)
         	g_value = predecessor.get_g_value() + op.get_cost();
     	else if (op.get_have_module_cost()){
     		// cout <<op.get_runtime_cost() << endl;
-    		g_value =  predecessor.get_g_value() + g_ext_func_manager.compute_function(g_instantiated_funcs_dict[op.get_runtime_cost()]);
+    		g_value =  predecessor.get_g_value() + g_ext_func_manager.compute_function_at(op.get_runtime_cost_func(), numeric_vars_val);
     	}
     	else {
-    		g_value = predecessor.get_g_value() + this->calculate_runtime_efect<float>(op.get_runtime_cost()) + 1;
+    		g_value = predecessor.get_g_value() + this->calculate_runtime_efect<float>(op.get_compiled_runtime_cost()) + 1;
     	}
     }
 
@@ -1166,33 +1150,61 @@ State::State(const State &predecessor, const Operator &op)
     	g_value = g_value - 1;
 }
 
-float get_new_time_window(Operator op, State* curr, float op_duration, vector<pair<int, float>* > ex_const_vector, int value) {
+static bool blocked_var_less(const blocked_var &a, const blocked_var &b) {
+	return a.var < b.var;
+}
+
+void State::add_blocked_var(const blocked_var &block) {
+	// Keep blocked_vars sorted by variable (stable for blocks on the same one)
+	vector<blocked_var>::iterator pos =
+			upper_bound(blocked_vars.begin(), blocked_vars.end(), block, blocked_var_less);
+	blocked_vars.insert(pos, block);
+}
+
+void State::remove_blocked_vars(const string &non_temporal_action_name) {
+	int kept = 0;
+	for(int i = 0; i < blocked_vars.size(); i++)
+		if(blocked_vars[i].non_temporal_action_name != non_temporal_action_name) {
+			if(kept != i)
+				blocked_vars[kept] = blocked_vars[i];
+			kept++;
+		}
+	blocked_vars.resize(kept);
+}
+
+pair<int, int> State::get_blocked_var_range(int var) const {
+	blocked_var key;
+	key.var = var;
+	vector<blocked_var>::const_iterator first =
+			lower_bound(blocked_vars.begin(), blocked_vars.end(), key, blocked_var_less);
+	vector<blocked_var>::const_iterator last =
+			upper_bound(first, blocked_vars.end(), key, blocked_var_less);
+	return make_pair(first - blocked_vars.begin(), last - blocked_vars.begin());
+}
+
+float get_new_time_window(const Operator &, const State *curr, float op_duration,
+		const SharedVarTimeline &timeline, int value) {
 
 	float new_init_time = 0;
 	float current_time = curr->get_g_current_time_value();
 
+	// Only the window strictly containing the current time can qualify
 	bool new_window_found = false;
-	for(int i = 0; i < (ex_const_vector.size() - 1); i++)
+	int i = timeline.find_window(current_time);
+	if((i != -1) && (current_time < timeline.times[i + 1]) && (value == timeline.values[i]))
 	{
-		if((current_time > ex_const_vector[i]->second) &&
-				(current_time < ex_const_vector[i + 1]->second) &&
-				(value == ex_const_vector[i]->first))
+		float time_window_size = timeline.times[i + 1] - timeline.times[i];
+		if(op_duration < time_window_size)
 		{
-			float time_window_size =
-					(ex_const_vector[i + 1]->second) -
-					(ex_const_vector[i]->second);
-			if(op_duration < time_window_size)
-			{
-				new_window_found = true;
-				new_init_time = ex_const_vector[i]->second;
-			}
+			new_window_found = true;
+			new_init_time = timeline.times[i];
 		}
 	}
 
-	if((!new_window_found) && (ex_const_vector[ex_const_vector.size() - 1]->first == value))
+	if((!new_window_found) && (timeline.values.back() == value))
 	{
 			new_window_found = true;
-			new_init_time = ex_const_vector[ex_const_vector.size() - 1]->second;
+			new_init_time = timeline.times.back();
 	}
 
 	return new_init_time;
@@ -1210,6 +1222,40 @@ bool State::operator<(const State &other) const {
 				   other.vars.begin(), other.vars.end());
 }
 
+static inline unsigned long long mix_hash(unsigned long long hash, unsigned long long value) {
+    // splitmix64 finalizer applied to the combined value
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+static inline unsigned long long mix_float(unsigned long long hash, float value) {
+    value = value == 0 ? 0 : value; // -0 == 0
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return mix_hash(hash, bits);
+}
+
+unsigned long long State::get_hash() const {
+    unsigned long long hash = vars.size();
+    for(int i = 0; i < vars.size(); i++)
+	hash = mix_hash(hash, (unsigned int) vars[i]);
+    for(int i = 0; i < numeric_vars_val.size(); i++)
+	hash = mix_float(hash, numeric_vars_val[i]);
+    return hash;
+}
+
+unsigned long long State::get_temporal_hash() const {
+    unsigned long long hash = mix_float(get_hash(), g_current_time_value);
+    hash = mix_hash(hash, running_actions.size());
+    for(int i = 0; i < running_actions.size(); i++) {
+	hash = mix_hash(hash, std::hash<string>()(running_actions[i].non_temporal_action_name));
+	hash = mix_float(hash, running_actions[i].time_end);
+    }
+    return hash;
+}
+
 void State::set_landmarks_for_initial_state() {
     hash_set<const LandmarkNode*, hash_pointer> initial_state_landmarks;
     if(g_lgraph == NULL) {
@@ -1241,6 +1287,26 @@ void State::set_landmarks_for_initial_state() {
     cout << initial_state_landmarks.size() << " initial landmarks, " 
 	 << g_goal.size() << " goal landmarks" << endl; 
     reached_lms = initial_state_landmarks;
+
+    const set<LandmarkNode*>& nodes = g_lgraph->get_nodes();
+    lm_leaves.clear();
+    needed_lms.clear();
+    needed_lms_cost = 0;
+    for(set<LandmarkNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+	if(reached_lms.find(*it) == reached_lms.end()) {
+	    if(landmark_is_leaf(**it, reached_lms))
+		lm_leaves.insert(*it);
+	} else {
+	    update_needed_landmark(*it);
+	}
+    }
+    goal_value_of_var.assign(g_variable_domain.size(), -1);
+    missing_goals = 0;
+    for(int i = 0; i < g_goal.size(); i++) {
+	goal_value_of_var[g_goal[i].first] = g_goal[i].second;
+	if((*this)[g_goal[i].first] != g_goal[i].second)
+	    missing_goals++;
+    }
 }
 
 bool State::landmark_is_leaf(const LandmarkNode& node, 
@@ -1322,44 +1388,250 @@ int State::check_partial_plan(hash_set<const LandmarkNode*, hash_pointer>& reach
 }
 
 template <typename T>
-T State::calculate_runtime_efect(string s_effect) const {
-	// First get current value of runtime numerical variables
-	string s_eff_aux = s_effect;
-	while(s_effect.find(":") != string::npos){
-		string var = "";
+T State::calculate_runtime_efect(const string &s_effect) const {
+	return evaluate_runtime_effect<T>(s_effect, numeric_vars_val);
+}
+
+template <typename T>
+T State::calculate_runtime_efect(const CompiledRuntimeEffect *effect) const {
+	return evaluate_runtime_effect<T>(effect, numeric_vars_val);
+}
+
+/* Runtime effects are exprtk expressions over numeric variables written as
+   ":N:". Each distinct effect is compiled once, with ":N:" turned into an
+   exprtk variable bound to a slot of the effect's own value buffer, so an
+   evaluation only copies the referenced values and calls value(). */
+struct CompiledRuntimeEffect {
+    exprtk::symbol_table<float> symbol_table;
+    exprtk::expression<float> expression;
+    vector<int> vars;     // numeric variable of each buffer slot
+    vector<float> values; // buffer bound to the expression variables
+
+    // Most effects are linear (constant + sum of coeff * var); those are
+    // evaluated directly without going through exprtk.
+    bool is_linear;
+    LinearRuntimeEffect linear;
+};
+
+/* Small recursive-descent parser recognising linear runtime effects built
+   from numbers, :N: variables, parentheses, unary signs, + and -, products
+   with a constant factor and divisions by a constant. */
+class LinearEffectParser {
+    const string &str;
+    size_t pos;
+    bool ok;
+
+    void skip_blanks() {
+	while(pos < str.length() && isspace(str[pos]))
+	    pos++;
+    }
+    bool accept(char c) {
+	skip_blanks();
+	if(pos < str.length() && str[pos] == c) {
+	    pos++;
+	    return true;
+	}
+	return false;
+    }
+    static void add_scaled(LinearRuntimeEffect &to, const LinearRuntimeEffect &from, float factor) {
+	to.constant += factor * from.constant;
+	for(int i = 0; i < from.terms.size(); i++) {
+	    bool merged = false;
+	    for(int j = 0; j < to.terms.size() && !merged; j++)
+		if(to.terms[j].first == from.terms[i].first) {
+		    to.terms[j].second += factor * from.terms[i].second;
+		    merged = true;
+		}
+	    if(!merged)
+		to.terms.push_back(make_pair(from.terms[i].first, factor * from.terms[i].second));
+	}
+    }
+    static void scale(LinearRuntimeEffect &lin, float factor) {
+	lin.constant *= factor;
+	for(int i = 0; i < lin.terms.size(); i++)
+	    lin.terms[i].second *= factor;
+    }
+
+    LinearRuntimeEffect parse_factor() {
+	LinearRuntimeEffect result;
+	result.constant = 0;
+	skip_blanks();
+	if(!ok || pos >= str.length()) {
+	    ok = false;
+	} else if(accept('-')) {
+	    result = parse_factor();
+	    scale(result, -1);
+	} else if(accept('+')) {
+	    result = parse_factor();
+	} else if(accept('(')) {
+	    result = parse_expression();
+	    if(!accept(')'))
+		ok = false;
+	} else if(str[pos] == ':') {
+	    size_t close = str.find(':', pos + 1);
+	    if(close == string::npos) {
+		ok = false;
+	    } else {
+		char *end;
+		string var = str.substr(pos + 1, close - pos - 1);
+		long i_var = strtol(var.c_str(), &end, 10);
+		if(var.empty() || *end != '\0')
+		    ok = false;
+		result.terms.push_back(make_pair(int(i_var), 1.0f));
+		pos = close + 1;
+	    }
+	} else if(isdigit(str[pos]) || str[pos] == '.') {
+	    char *end;
+	    result.constant = float(strtod(str.c_str() + pos, &end));
+	    pos = end - str.c_str();
+	} else {
+	    ok = false; // functions, operators such as ^, comparisons...
+	}
+	return result;
+    }
+    LinearRuntimeEffect parse_term() {
+	LinearRuntimeEffect result = parse_factor();
+	while(ok) {
+	    bool multiply = accept('*');
+	    if(!multiply && !accept('/'))
+		break;
+	    LinearRuntimeEffect rhs = parse_factor();
+	    if(!rhs.terms.empty()) {
+		if(!multiply || !result.terms.empty()) {
+		    ok = false;
+		    break;
+		}
+		scale(rhs, result.constant);
+		result = rhs;
+	    } else if(multiply) {
+		scale(result, rhs.constant);
+	    } else if(rhs.constant == 0) {
+		ok = false;
+	    } else {
+		result.constant /= rhs.constant;
+		for(int i = 0; i < result.terms.size(); i++)
+		    result.terms[i].second /= rhs.constant;
+	    }
+	}
+	return result;
+    }
+    LinearRuntimeEffect parse_expression() {
+	LinearRuntimeEffect result = parse_term();
+	while(ok) {
+	    float sign;
+	    if(accept('+'))
+		sign = 1;
+	    else if(accept('-'))
+		sign = -1;
+	    else
+		break;
+	    LinearRuntimeEffect rhs = parse_term();
+	    add_scaled(result, rhs, sign);
+	}
+	return result;
+    }
+public:
+    LinearEffectParser(const string &s) : str(s), pos(0), ok(true) {}
+    bool parse(LinearRuntimeEffect &lin) {
+	lin = parse_expression();
+	skip_blanks();
+	return ok && pos == str.length();
+    }
+};
+
+static unordered_map<string, CompiledRuntimeEffect *> compiled_runtime_effects;
+
+static CompiledRuntimeEffect *compile_runtime_effect(const string &s_effect) {
+	unordered_map<string, CompiledRuntimeEffect *>::iterator it = compiled_runtime_effects.find(s_effect);
+	if(it != compiled_runtime_effects.end())
+		return it->second;
+
+	CompiledRuntimeEffect *effect = new CompiledRuntimeEffect;
+
+	// Replace every ":N:" by the variable name "vN"
+	string expression_string = "";
+	size_t pos = 0;
+	while(pos < s_effect.length()) {
+		size_t open = s_effect.find(":", pos);
+		size_t close = (open == string::npos) ? string::npos : s_effect.find(":", open + 1);
+		if(close == string::npos) {
+			expression_string += s_effect.substr(pos);
+			break;
+		}
+		string var = s_effect.substr(open + 1, close - open - 1);
 		int i_var;
-		float var_value;
-		s_eff_aux = s_eff_aux.substr(s_eff_aux.find(":") + 1, s_eff_aux.length() - 1);
-		var = s_eff_aux.substr(0, s_eff_aux.find(":"));
-		s_eff_aux = s_eff_aux.substr(s_eff_aux.find(":") + 1, s_eff_aux.length() - 1);
 		stringstream strm(var);
 		strm >> i_var;
-		var_value = numeric_vars_val[i_var];
-		std::ostringstream strm_var;
-   		strm_var << var_value;
-
-		string from = ":" + var + ":";
-		string to = strm_var.str();
-	    size_t start_pos = 0;
-	    while((start_pos = s_effect.find(from, start_pos)) != std::string::npos) {
-	    	s_effect.replace(start_pos, from.length(), to);
-	        start_pos += to.length(); // Handles case where 'to' is a substring of 'from'
-	    }
+		expression_string += s_effect.substr(pos, open - pos) + "v" + var;
+		if(find(effect->vars.begin(), effect->vars.end(), i_var) == effect->vars.end())
+			effect->vars.push_back(i_var);
+		pos = close + 1;
 	}
 
-	// cout << s_effect << endl;
-
-    // now solve the operation
-	typedef exprtk::symbol_table<T> symbol_table_t;
-	typedef exprtk::expression<T>   expression_t;
-	typedef exprtk::parser<T>       parser_t;
-	T result = 0;
-	symbol_table_t symbol_table;
-	symbol_table.add_constants();
-	expression_t expression;
-	expression.register_symbol_table(symbol_table);
-	parser_t parser;
-	parser.compile(s_effect,expression);
-	result = expression.value();
-	return result;
+	// The buffer must not move once its slots are bound
+	effect->values.resize(effect->vars.size(), 0);
+	effect->symbol_table.add_constants();
+	for(int i = 0; i < effect->vars.size(); i++) {
+		ostringstream name;
+		name << "v" << effect->vars[i];
+		effect->symbol_table.add_variable(name.str(), effect->values[i]);
+	}
+	effect->expression.register_symbol_table(effect->symbol_table);
+	exprtk::parser<float> parser;
+	if(!parser.compile(expression_string, effect->expression))
+		cout << "Could not compile runtime effect " << s_effect << endl;
+
+	LinearEffectParser linear_parser(s_effect);
+	effect->is_linear = linear_parser.parse(effect->linear);
+
+	compiled_runtime_effects[s_effect] = effect;
+	return effect;
+}
+
+bool get_linear_runtime_effect(const string &s_effect, LinearRuntimeEffect &linear) {
+	CompiledRuntimeEffect *effect = compile_runtime_effect(s_effect);
+	if(effect->is_linear)
+		linear = effect->linear;
+	return effect->is_linear;
 }
+
+const vector<int> &get_runtime_effect_vars(const string &s_effect) {
+	return compile_runtime_effect(s_effect)->vars;
+}
+
+void compile_runtime_effects() {
+	// Each effect is looked up by its string only here; evaluations during
+	// search go through the pointers stored in the operators.
+	for(int i = 0; i < g_operators.size(); i++) {
+		Operator &op = g_operators[i];
+		for(int j = 0; j < op.pre_post.size(); j++)
+			if(op.pre_post[j].have_runtime_cost_effect)
+				op.pre_post[j].runtime_effect = compile_runtime_effect(op.pre_post[j].runtime_cost_effect);
+		for(int j = 0; j < op.pre_block.size(); j++)
+			if(op.pre_block[j].have_runtime_cost_effect)
+				op.pre_block[j].runtime_effect = compile_runtime_effect(op.pre_block[j].runtime_cost_effect);
+		if(op.have_runtime_cost)
+			op.compiled_runtime_cost = compile_runtime_effect(op.runtime_cost);
+	}
+}
+
+template <typename T>
+T evaluate_runtime_effect(const string &s_effect, const vector<float> &numeric_vars_val) {
+	return evaluate_runtime_effect<T>(compile_runtime_effect(s_effect), numeric_vars_val);
+}
+
+template <typename T>
+T evaluate_runtime_effect(const CompiledRuntimeEffect *effect, const vector<float> &numeric_vars_val) {
+	assert(effect);
+	if(effect->is_linear)
+		return effect->linear.evaluate(numeric_vars_val);
+	// The buffer is bound to the expression, filling it is not a change of
+	// the compiled effect as seen by the operators
+	CompiledRuntimeEffect *bound = const_cast<CompiledRuntimeEffect *>(effect);
+	for(int i = 0; i < effect->vars.size(); i++)
+		bound->values[i] = numeric_vars_val[effect->vars[i]];
+	return effect->expression.value();
+}
+
+template float evaluate_runtime_effect<float>(const string &s_effect, const vector<float> &numeric_vars_val);
+template float evaluate_runtime_effect<float>(const CompiledRuntimeEffect *effect, const vector<float> &numeric_vars_val);
@@ -29,6 +29,7 @@
 #include <vector>
 #include <ext/hash_set>
 #include "landmarks_types.h"
+#include <set>
 #include <string>
 
 using namespace std;
@@ -37,6 +38,7 @@ using namespace __gnu_cxx;
 class Operator;
 class PrePost;
 class LandmarkNode;
+struct CompiledRuntimeEffect;
 
 typedef struct{
 	int var;
@@ -59,12 +61,21 @@ class State {
     vector<int> vars; // values for vars
     hash_set<const LandmarkNode *, hash_pointer> reached_lms;
     int reached_lms_cost;
+    // Maintained with reached_lms: the unreached landmarks whose parents
+    // are all reached, the reached ones needed again and the unsatisfied goals
+    set<const LandmarkNode *> lm_leaves;
+    hash_set<const LandmarkNode *, hash_pointer> needed_lms;
+    int needed_lms_cost;
+    int missing_goals;
 
     float g_value; // min. cost of reaching this state from the initial state
     float g_time_value;
     float g_current_time_value;
     void set_landmarks_for_initial_state();
-    void update_reached_lms(const Operator &op);
+    void update_reached_lms(const State &predecessor);
+    void reach_landmarks(vector<const LandmarkNode *> &candidates,
+			 vector<const LandmarkNode *> &changed);
+    void update_needed_landmark(const LandmarkNode *node);
     bool landmark_is_leaf(const LandmarkNode& node, 
 			  const hash_set<const LandmarkNode*, hash_pointer>& reached) const;
     bool check_lost_landmark_children_needed_again(const LandmarkNode& node) const;
@@ -90,6 +101,10 @@ public:
     }
     void dump() const;
     bool operator<(const State &other) const;
+    // Hash of the variable values and numeric values, used by heuristic caches
+    unsigned long long get_hash() const;
+    // get_hash extended with the running actions and the current time
+    unsigned long long get_temporal_hash() const;
 
     float get_g_value() const {return g_value;}
     float get_g_time_value() const {return g_time_value;}
@@ -97,15 +112,52 @@ public:
     void  set_g_time_value(float time) {g_time_value = time;}
     void  set_g_current_time_value(float time) {g_current_time_value = time;}
     void change_ancestor(const State &new_predecessor, const Operator &new_op);
+
+    // blocked_vars is kept sorted by variable, so that the blocks on a
+    // variable are the contiguous range [first, second)
+    void add_blocked_var(const blocked_var &block);
+    void remove_blocked_vars(const string &non_temporal_action_name);
+    pair<int, int> get_blocked_var_range(int var) const;
     vector<int> get_vars_state(){return vars;};
     vector<float> get_num_vars_state(){return numeric_vars_val;};
 
     int check_partial_plan(hash_set<const LandmarkNode*, hash_pointer>& reached) const;
     int get_needed_landmarks(hash_set<const LandmarkNode*, hash_pointer>& needed) const;
+    const hash_set<const LandmarkNode*, hash_pointer> &get_reached_lms() const {return reached_lms;}
+    int get_reached_lms_cost() const {return reached_lms_cost;}
+    const set<const LandmarkNode*> &get_landmark_leaves() const {return lm_leaves;}
+    int get_needed_lms_count() const {return needed_lms.size();}
+    int get_needed_lms_cost() const {return needed_lms_cost;}
+    int get_missing_goals() const {return missing_goals;}
+    template <typename T>
+    T calculate_runtime_efect(const string &s_effect) const;
     template <typename T>
-    T calculate_runtime_efect(string s_effect) const;
+    T calculate_runtime_efect(const CompiledRuntimeEffect *effect) const;
+};
+
+// Runtime effect of the form constant + sum of coeff * numeric var
+struct LinearRuntimeEffect {
+    float constant;
+    vector<pair<int, float> > terms;
+    float evaluate(const vector<float> &numeric_vars_val) const {
+	float result = constant;
+	for(int i = 0; i < terms.size(); i++)
+	    result += terms[i].second * numeric_vars_val[terms[i].first];
+	return result;
+    }
 };
 
-float get_new_time_window(Operator op, State* curr, float op_duration, vector<pair<int, float>* > ex_const_vector, int value);
+template <typename T>
+T evaluate_runtime_effect(const string &s_effect, const vector<float> &numeric_vars_val);
+// Effects compiled at load, see PrePost::runtime_effect
+template <typename T>
+T evaluate_runtime_effect(const CompiledRuntimeEffect *effect, const vector<float> &numeric_vars_val);
+void compile_runtime_effects();
+const vector<int> &get_runtime_effect_vars(const string &s_effect);
+bool get_linear_runtime_effect(const string &s_effect, LinearRuntimeEffect &linear);
+
+struct SharedVarTimeline;
+float get_new_time_window(const Operator &op, const State *curr, float op_duration,
+		const SharedVarTimeline &timeline, int value);
 
 #endif
@@ -24,6 +24,8 @@
 #include "state.h"
 #include "successor_generator.h"
 
+#include <cassert>
+#include <climits>
 #include <cstdlib>
 #include <iostream>
 #include <vector>
@@ -68,461 +70,449 @@ void SuccessorGeneratorSwitch::generate_applicable_ops(
     if(curr[switch_var] != -1)
     	generator_for_value[curr[switch_var]]->generate_applicable_ops(curr, ops);
     default_generator->generate_applicable_ops(curr, ops);
-    /*check_functional_validity(curr, ops);
-    check_var_locks_validity(curr, ops);
-    check_temporal_soundness_validity(curr, ops);*/
 }
 
-void check_functional_validity(
-		const State &curr, vector<const Operator *> &ops) {
-	vector<const Operator *>::iterator it = ops.begin();
+/* Validity filters for the candidate operators of an expansion.
 
-	for(; it != ops.end();) {
-		const Operator * op = *it;
+   Every filter only depends on the current state and on the operator, so
+   the state-dependent part (numeric values projected to the current time,
+   earliest-ending running action, shared-var windows) is computed once per
+   expansion, each operator is evaluated at most once and its verdict is
+   cached by operator index for the preferred operators. */
 
-		// we have to update the numeric values up to the point to which the action has been executed
-		// create an auxiliary numeric values vector
-		State* aux_state = new State(curr);
-		for(int j = 0; j < curr.numeric_vars_val.size(); j++)
-		{
-			aux_state->numeric_vars_val[j] = curr.numeric_vars_val[j];
-		}
-
-		// apply the numeric effects that are running, rules are:
-		// -- increase and decrease effects happen during all the time the action executes
-		// -- assign effects happen abruptly at the end of the action
-		// These rules aim to imitate real world behaviors
+struct ValidityContext {
+    const State *curr;
+    vector<float> projected_numeric;      // numeric values at the current time
+    const runn_action *min_action_ending; // running action that has to end first
+    float next_time;                      // end time of start and instant snaps
+    vector<int> next_time_window;         // per shared timeline, window of next_time
+};
 
-		vector<runn_action>::const_iterator it_ra = curr.running_actions.begin();
-		for(; (is_temporal) && (it_ra != curr.running_actions.end()); ++it_ra) {
-
-			// calculate how much time has passed
-			float action_duration = (*it_ra).time_end - (*it_ra).time_start;
-			float time_passed = curr.get_g_current_time_value() - (*it_ra).time_start;
-			float peroneage_completed = (time_passed / action_duration);
-
-			vector<PrePost*>::const_iterator it_fc = (*it_ra).functional_costs.begin();
-			for(; it_fc != (*it_ra).functional_costs.end(); ++it_fc) {
-
-				// calculate new values taking into account the time that has passed
-				PrePost pre_post = *(*it_fc);
-				switch(pre_post.pre){
-					case -2:{
-						if (!pre_post.have_runtime_cost_effect && !pre_post.have_module_cost_effect){
-							aux_state->numeric_vars_val[pre_post.var] = aux_state->numeric_vars_val[pre_post.var] + (pre_post.f_cost * peroneage_completed);
-						} else if (pre_post.have_module_cost_effect){
-							aux_state->numeric_vars_val[pre_post.var]  = aux_state->numeric_vars_val[pre_post.var] +
-									(g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]) * peroneage_completed);
-						}
-						else{
-							aux_state->numeric_vars_val[pre_post.var] = aux_state->numeric_vars_val[pre_post.var] +
-									(aux_state->calculate_runtime_efect<float>(pre_post.runtime_cost_effect) * peroneage_completed);
-						}
-
-						break;
-					}
-					case -3:
-						if (!pre_post.have_runtime_cost_effect && !pre_post.have_module_cost_effect)
-							aux_state->numeric_vars_val[pre_post.var] = aux_state->numeric_vars_val[pre_post.var] - (pre_post.f_cost * peroneage_completed);
-						else if (pre_post.have_module_cost_effect){
-							aux_state->numeric_vars_val[pre_post.var]  = aux_state->numeric_vars_val[pre_post.var] -
-									(g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pre_post.runtime_cost_effect]) * peroneage_completed);
-						}
-						else{
-							aux_state->numeric_vars_val[pre_post.var] = aux_state->numeric_vars_val[pre_post.var] -
-									(aux_state->calculate_runtime_efect<float>(pre_post.runtime_cost_effect) * peroneage_completed);
-						}
-						break;
-
-					case -4:
-					case -5:
-					case -6:
-						break;
-
-					default:
-						break;
-					}
+/* Start snap durations in structure-of-arrays form. Constant and linear
+   durations (the usual "a * x + b * y + c" expressions) are evaluated for
+   all candidate operators in one pass per expansion into a scratch array,
+   and module durations with one batched call to the external function
+   manager; only the remaining runtime durations go through the generic
+   evaluator, lazily. */
+
+enum {
+    duration_none,     // not a start snap or no duration effect
+    duration_linear,   // constant or linear runtime expression
+    duration_module,   // external module function
+    duration_dynamic   // non-linear runtime expression
+};
 
+static vector<unsigned char> duration_kind;
+static vector<float> duration_constant;
+static vector<int> duration_term_begin; // terms of op i in [begin[i], begin[i + 1])
+static vector<int> duration_term_var;
+static vector<float> duration_term_coeff;
+
+static vector<int> duration_epoch;
+static vector<float> duration_scratch;
+
+static void build_duration_table() {
+	int num_ops = g_operators.size();
+	duration_kind.assign(num_ops, duration_none);
+	duration_constant.assign(num_ops, 0);
+	duration_term_begin.assign(num_ops + 1, 0);
+	duration_term_var.clear();
+	duration_term_coeff.clear();
+	duration_epoch.assign(num_ops, -1);
+	duration_scratch.assign(num_ops, 0);
+
+	for(int i = 0; i < num_ops; i++) {
+		duration_term_begin[i] = duration_term_var.size();
+		const Operator &op = g_operators[i];
+		const PrePost *dur = op.get_duration_effect();
+		if(!op.is_start_snap() || (dur == 0))
+			continue;
+		LinearRuntimeEffect linear;
+		if(dur->have_module_cost_effect) {
+			duration_kind[i] = duration_module;
+		} else if(!dur->have_runtime_cost_effect) {
+			duration_kind[i] = duration_linear;
+			duration_constant[i] = dur->f_cost;
+		} else if(get_linear_runtime_effect(dur->runtime_cost_effect, linear)) {
+			duration_kind[i] = duration_linear;
+			duration_constant[i] = linear.constant;
+			for(int j = 0; j < linear.terms.size(); j++) {
+				duration_term_var.push_back(linear.terms[j].first);
+				duration_term_coeff.push_back(linear.terms[j].second);
 			}
+		} else {
+			duration_kind[i] = duration_dynamic;
 		}
+	}
+	duration_term_begin[num_ops] = duration_term_var.size();
+}
 
+// Only the module durations are requested: compute_batch_durations consumes
+// them in this same expansion, whereas the module effects are evaluated when
+// a successor is opened, which for most of them never happens
+static void prefetch_module_durations(const State &curr, const vector<const Operator *> &ops) {
+	static vector<int> funcs;
+	funcs.clear();
+	for(int i = 0; i < ops.size(); i++) {
+		int op_no = ops[i] - &g_operators[0];
+		if(duration_kind[op_no] == duration_module)
+			funcs.push_back(g_operators[op_no].get_duration_effect()->ext_func);
+	}
+	if(!funcs.empty())
+		g_ext_func_manager.prefetch(funcs, curr.numeric_vars_val);
+}
 
-
-
-		bool op_valid = true;
-		vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
-		for(; it_pp != op->get_pre_post().end(); ++it_pp) {
-			PrePost pp = *it_pp;
-			if(pp.pre == -5)
-			{
-				// cout << "Checking " << op->get_name() << endl;
-				// cout << aux_state->numeric_vars_val[pp.var] << "<" << pp.f_cost << endl;
-				if (aux_state->numeric_vars_val[pp.var] < pp.f_cost) {
-					op_valid = false;
-					break;
-				}
-			}else if(pp.pre == -6) {
-				if (aux_state->numeric_vars_val[pp.var] > pp.f_cost) {
-					op_valid = false;
-					break;
-				}
-			}
-
-			if(!op_valid)
-				break;
+static void compute_batch_durations(const State &curr, const vector<const Operator *> &ops, int epoch) {
+	const vector<float> &numeric = curr.numeric_vars_val;
+	static vector<int> module_ops, module_funcs;
+	static vector<double> module_results;
+	module_ops.clear();
+	module_funcs.clear();
+	for(int i = 0; i < ops.size(); i++) {
+		int op_no = ops[i] - &g_operators[0];
+		if(duration_epoch[op_no] == epoch)
+			continue;
+		if(duration_kind[op_no] == duration_module) {
+			module_ops.push_back(op_no);
+			module_funcs.push_back(g_operators[op_no].get_duration_effect()->ext_func);
+			duration_epoch[op_no] = epoch;
+			continue;
 		}
-
-		delete aux_state ;
-
-		if (!op_valid){
-			it = ops.erase(it);
-		}else
-			it++;
+		if(duration_kind[op_no] != duration_linear)
+			continue;
+		float value = duration_constant[op_no];
+		for(int k = duration_term_begin[op_no]; k < duration_term_begin[op_no + 1]; k++)
+			value += duration_term_coeff[k] * numeric[duration_term_var[k]];
+		duration_scratch[op_no] = value;
+		duration_epoch[op_no] = epoch;
+	}
+	if(!module_ops.empty()) {
+		g_ext_func_manager.compute_functions_at(module_funcs, numeric, module_results);
+		for(int i = 0; i < module_ops.size(); i++)
+			duration_scratch[module_ops[i]] = module_results[i];
 	}
 }
 
-void check_external_locks_validity(const State &curr, vector<const Operator *> &ops) {
-	vector<const Operator *>::iterator it = ops.begin();
-	for(; it != ops.end();) {
-		const Operator * op = *it;
-		bool op_valid = true;
-
-		// Get action duration, temporal duration, not snap.
-		// start --- end
-		float op_end_time = curr.get_g_current_time_value() + 0.01;
-		float op_duration = 0;
-		if(op->get_name().find("_end") != string::npos)
-		{
-			vector<runn_action>::const_iterator it_ra = curr.running_actions.begin();
-			for(; it_ra != curr.running_actions.end();)
-			{
-				if((*it_ra).non_temporal_action_name == op->get_non_temporal_action_name())
-				{
-					op_end_time = (*it_ra).time_end;
-				}else{
-					it_ra++;
-				}
+// Duration of a start snap, read from the batch scratch or evaluated lazily
+class OperatorDuration {
+    const State &curr;
+    const Operator *op;
+    int op_no;
+    int epoch;
+    bool known;
+    float duration;
+public:
+    OperatorDuration(const State &c, const Operator *o, int no, int e)
+	: curr(c), op(o), op_no(no), epoch(e), known(false), duration(0) {}
+    float get() {
+	if(!known) {
+	    known = true;
+	    if(duration_epoch[op_no] == epoch) {
+		duration = duration_scratch[op_no];
+	    } else if(duration_kind[op_no] == duration_dynamic) {
+		const PrePost *dur = op->get_duration_effect();
+		duration = curr.calculate_runtime_efect<float>(dur->runtime_effect);
+	    }
+	}
+	return duration;
+    }
+};
 
-				break;
-			}
-		} else if(op->get_name().find("_start") != string::npos)
-		{
-			// Get the duration calculating the cost from the current state
-			vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
-			for(; it_pp != op->get_pre_post().end(); ++it_pp) {
-				PrePost pp = *it_pp;
-				if(g_variable_name[pp.var] == total_time_var)
-				{
-					if(pp.have_runtime_cost_effect)
-					{
-						op_duration = curr.calculate_runtime_efect<float>(pp.runtime_cost_effect);
-					} else if(pp.have_module_cost_effect)
-					{
-						op_duration = g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pp.runtime_cost_effect]);
+enum {
+    verdict_valid = 1,
+    verdict_timed_goals_valid = 2
+};
+
+static vector<int> verdict_epoch;
+static vector<unsigned char> verdict;
+static int current_verdict_epoch = 0;
+
+static void compute_validity_context(const State &curr, ValidityContext &ctx) {
+	ctx.curr = &curr;
+
+	// we have to update the numeric values up to the point to which the actions have been executed
+	ctx.projected_numeric = curr.numeric_vars_val;
+	vector<float> &numeric = ctx.projected_numeric;
+
+	// apply the numeric effects that are running, rules are:
+	// -- increase and decrease effects happen during all the time the action executes
+	// -- assign effects happen abruptly at the end of the action
+	// These rules aim to imitate real world behaviors
+	vector<runn_action>::const_iterator it_ra = curr.running_actions.begin();
+	for(; (is_temporal) && (it_ra != curr.running_actions.end()); ++it_ra) {
+
+		// calculate how much time has passed
+		float action_duration = (*it_ra).time_end - (*it_ra).time_start;
+		float time_passed = curr.get_g_current_time_value() - (*it_ra).time_start;
+		float peroneage_completed = (time_passed / action_duration);
+
+		vector<PrePost*>::const_iterator it_fc = (*it_ra).functional_costs.begin();
+		for(; it_fc != (*it_ra).functional_costs.end(); ++it_fc) {
+
+			// calculate new values taking into account the time that has passed
+			const PrePost &pre_post = *(*it_fc);
+			switch(pre_post.pre){
+				case -2:{
+					if (!pre_post.have_runtime_cost_effect && !pre_post.have_module_cost_effect){
+						numeric[pre_post.var] = numeric[pre_post.var] + (pre_post.f_cost * peroneage_completed);
+					} else if (pre_post.have_module_cost_effect){
+						numeric[pre_post.var] = numeric[pre_post.var] +
+								(g_ext_func_manager.compute_function_at(pre_post.ext_func, numeric) * peroneage_completed);
 					}
-					else {
-						op_duration = pp.f_cost;
+					else{
+						numeric[pre_post.var] = numeric[pre_post.var] +
+								(evaluate_runtime_effect<float>(pre_post.runtime_effect, numeric) * peroneage_completed);
 					}
+
 					break;
 				}
-			}
-		}
-
-		/* bool action_changes_constraint = false;
-		for(int k = 0; k < external_blocked_vars.size(); k++)
-		{
-			if((external_blocked_vars[k]->time_set >= curr.get_g_current_time_value()) &&
-					(external_blocked_vars[k]->time_set < op_end_time))
-			{
-				vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
-				for(; it_pp != op->get_pre_post().end(); ++it_pp)
-				{
-
-					PrePost pp = *it_pp;
-					if(pp.var == external_blocked_vars[k]->var)
-					{
-						if((op->get_name().find("_end") != string::npos) && (curr.running_actions.size() != 1))
-						{
-							op_valid = false;
-							break;
-						} else if ((op->get_name().find("_start") != string::npos) && (curr.running_actions.size() != 0)){
-							op_valid = false;
-							break;
-						}
-						action_changes_constraint = true;
+				case -3:
+					if (!pre_post.have_runtime_cost_effect && !pre_post.have_module_cost_effect)
+						numeric[pre_post.var] = numeric[pre_post.var] - (pre_post.f_cost * peroneage_completed);
+					else if (pre_post.have_module_cost_effect){
+						numeric[pre_post.var] = numeric[pre_post.var] -
+								(g_ext_func_manager.compute_function_at(pre_post.ext_func, numeric) * peroneage_completed);
 					}
-				}
-			}
-		} */
-
-		for(int k = 0; (k < g_shared_vars_timed_values.size()) && (op_valid); k++)
-		{
-			vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
-			for(; it_pp != op->get_pre_post().end(); ++it_pp)
-			{
-				PrePost pp = *it_pp;
-				if(pp.var == g_shared_vars_timed_values[k]->first){
-					// Search constraint value at that time
-					bool tested = false;
-					for(int j = 0; j < (g_shared_vars_timed_values[k]->second->size() - 1); j++)
-					{
-						if((op_end_time > (*(g_shared_vars_timed_values[k]->second))[j]->second) &&
-								(op_end_time <= (*(g_shared_vars_timed_values[k]->second))[j + 1]->second))
-						{
-							tested = true;
-							if(((*(g_shared_vars_timed_values[k]->second))[j]->first != pp.pre) &&
-									(pp.pre != -1) &&
-									((*(g_shared_vars_timed_values[k]->second))[j]->first != -1)
-							  )
-							{
-								/* if((op->get_name().find("_end") != string::npos) && (curr.running_actions.size() != 1))
-								{
-									op_valid = false;
-									break;
-								} else */
-								if(!use_hard_temporal_constraints)
-								{
-									op_valid = false;
-									break;
-								}
-								if(is_temporal) {
-									if ((op->get_name().find("_start") != string::npos) && (curr.running_actions.size() != 0)){
-										op_valid = false;
-										break;
-									} else if (op->get_name().find("_end") != string::npos){
-										op_valid = false;
-										break;
-									}
-								}else {
-									op_valid = false;
-									break;
-								}
-							} else if(op_duration > (((*(g_shared_vars_timed_values[k]->second))[j + 1]->second) - (curr.get_g_current_time_value())))
-							{
-								/* if((op->get_name().find("_end") != string::npos) && (curr.running_actions.size() != 1))
-								{
-									op_valid = false;
-									break;
-								} else */
-								if(!use_hard_temporal_constraints)
-								{
-									op_valid = false;
-									break;
-								}
-								if(is_temporal) {
-									if ((op->get_name().find("_start") != string::npos) && (curr.running_actions.size() != 0)){
-										op_valid = false;
-										break;
-									} else if (op->get_name().find("_end") != string::npos){
-										op_valid = false;
-										break;
-									}
-								}
-							}
-						}
+					else{
+						numeric[pre_post.var] = numeric[pre_post.var] -
+								(evaluate_runtime_effect<float>(pre_post.runtime_effect, numeric) * peroneage_completed);
 					}
+					break;
 
-					if(!tested)
-					{
-						if(((*(g_shared_vars_timed_values[k]->second))[g_shared_vars_timed_values[k]->second->size() - 1]->first != pp.pre) &&
-								(pp.pre != -1) &&
-								((*(g_shared_vars_timed_values[k]->second))[g_shared_vars_timed_values[k]->second->size() - 1]->first != -1)
-						  )
-						{
-							op_valid = false;
-							break;
-						}
-					}
-				}
+				default:
+					break;
 			}
 		}
+	}
 
+	// Check that the action ending is the one that must happen first
+	ctx.min_action_ending = NULL;
+	float min_time = -1;
+	vector<runn_action>::const_iterator it_ra_const = curr.running_actions.begin();
+	for(; (it_ra_const != curr.running_actions.end()); it_ra_const++)
+	{
+		if((min_time == -1) || (min_time > (*it_ra_const).time_end))
+		{
+			min_time = (*it_ra_const).time_end;
+			ctx.min_action_ending = &(*it_ra_const);
+		}
+	}
 
-		if (!op_valid){
-			it = ops.erase(it);
+	ctx.next_time = curr.get_g_current_time_value() + 0.01;
+	ctx.next_time_window.resize(g_shared_vars_timelines.size());
+	for(int k = 0; k < g_shared_vars_timelines.size(); k++)
+		ctx.next_time_window[k] = g_shared_vars_timelines[k].find_window(ctx.next_time);
+}
 
-		}else
-			it++;
+static bool check_functional_validity(const ValidityContext &ctx, const Operator *op) {
+	const vector<int> &numeric_pre = op->get_numeric_pre();
+	for(int i = 0; i < numeric_pre.size(); i++) {
+		const PrePost &pp = op->get_pre_post()[numeric_pre[i]];
+		if(pp.pre == -5)
+		{
+			if (ctx.projected_numeric[pp.var] < pp.f_cost)
+				return false;
+		}else if(pp.pre == -6) {
+			if (ctx.projected_numeric[pp.var] > pp.f_cost)
+				return false;
+		}
 	}
+	return true;
+}
 
-	return;
+static bool check_temporal_soundness_validity(const ValidityContext &ctx, const Operator *op) {
+	// We have to assure that we do not apply actions that will happen later in time than others already running
+	if(op->is_end_snap() && (ctx.min_action_ending != NULL) &&
+			(ctx.min_action_ending->non_temporal_action_name != op->get_non_temporal_action_name()))
+		return false;
+	return true;
 }
 
-void check_var_locks_validity(
-		const State &curr, vector<const Operator *> &ops) {
-	vector<const Operator *>::iterator it = ops.begin();
-	for(; it != ops.end();) {
-		const Operator * op = *it;
+static bool check_var_locks_validity(const ValidityContext &ctx, const Operator *op, OperatorDuration &duration) {
+	const State &curr = *ctx.curr;
+	if(curr.blocked_vars.empty())
+		return true;
 
-		// Get action duration, temporal duration, not snap.
-		// start --- end
-		float op_duration = 0;
-		if(op->get_name().find("_start") != string::npos)
+	vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
+	for(; it_pp != op->get_pre_post().end(); ++it_pp) {
+		const PrePost &pp = *it_pp;
+		pair<int, int> range = curr.get_blocked_var_range(pp.var);
+		for(int k = range.first; k < range.second; k++)
 		{
-			vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
-			for(; it_pp != op->get_pre_post().end(); ++it_pp) {
-				PrePost pp = *it_pp;
-				if(g_variable_name[pp.var] == total_time_var)
-				{
-					if(pp.have_runtime_cost_effect)
-					{
-						op_duration = curr.get_g_current_time_value() + curr.calculate_runtime_efect<float>(pp.runtime_cost_effect);
-					} else if(pp.have_module_cost_effect)
-					{
-						op_duration = curr.get_g_current_time_value() + g_ext_func_manager.compute_function(g_instantiated_funcs_dict[pp.runtime_cost_effect]);
-					}else{
-						op_duration = curr.get_g_current_time_value() + pp.f_cost;
-					}
-
-					break;
-				}
-			}
+			const blocked_var &bv = curr.blocked_vars[k];
+			// check if the block was set for this end action
+			if(bv.non_temporal_action_name == op->get_non_temporal_action_name())
+				continue;
+
+			// If the block is over all and the value is different, the action is not valid
+			// the time the variable is unblock is not relevant in this case
+			if(bv.block_type == -7)
+				return false;
+
+			// If the block is at the end of the action, then the time at which the variable is freed has to be considered
+			float op_end_time = 0;
+			if(op->is_start_snap() && (op->get_duration_effect() != 0))
+				op_end_time = curr.get_g_current_time_value() + duration.get();
+			if(bv.time_freed > op_end_time)
+				return false;
 		}
+	}
+	return true;
+}
 
-
-		bool op_valid = true;
-		vector<PrePost>::const_iterator it_pp = op->get_pre_post().begin();
-		for(; it_pp != op->get_pre_post().end(); ++it_pp) {
-			PrePost pp = *it_pp;
-			for(int k = 0; k < curr.blocked_vars.size(); k++)
+static bool check_external_locks_validity(const ValidityContext &ctx, const Operator *op, OperatorDuration &duration) {
+	const State &curr = *ctx.curr;
+	const vector<int> &shared_effects = op->get_shared_effects();
+	if(shared_effects.empty() || g_shared_vars_timelines.empty())
+		return true;
+
+	// Get action duration, temporal duration, not snap.
+	// start --- end
+	float op_end_time = ctx.next_time;
+	if(op->is_end_snap())
+	{
+		vector<runn_action>::const_iterator it_ra = curr.running_actions.begin();
+		for(; it_ra != curr.running_actions.end();)
+		{
+			if((*it_ra).non_temporal_action_name == op->get_non_temporal_action_name())
 			{
-				if(curr.blocked_vars[k].var == pp.var)
-				{
-					if(curr.blocked_vars[k].block_type == -7)
-					{
-						// check if the block was set for this end action
-						if((curr.blocked_vars[k].non_temporal_action_name == op->get_non_temporal_action_name()))
-							continue;
-
-						// If the block is over all and the value is different, the action is not valid
-						// the time the variable is unblock is not relevant in this case
-						op_valid = false;
-						break;
-
-					} else{
-						// check if the block was set for this end action
-						if((curr.blocked_vars[k].non_temporal_action_name == op->get_non_temporal_action_name()))
-							continue;
-						// If the block is at the end of the action, then the time at which the variable is freed has to be considered
-						if(curr.blocked_vars[k].time_freed > op_duration){
-							op_valid = false;
-							break;
-						}
-					}
-				}
+				op_end_time = (*it_ra).time_end;
+			}else{
+				it_ra++;
 			}
 
-			if(!op_valid)
-				break;
+			break;
 		}
-
-		if (!op_valid){
-			it = ops.erase(it);
-
-		}else
-			it++;
 	}
-}
 
-void check_temporal_soundness_validity(
-		const State &curr, vector<const Operator *> &ops) {
-	// We have to assure that we do not apply actions that will happen later in time than others already running
-	vector<const Operator *>::iterator it = ops.begin();
-	for(; it != ops.end();) {
-		const Operator * op = *it;
-		bool op_valid = true;
-		if(op->get_name().find("_end") != string::npos)
+	for(int e = 0; e < shared_effects.size(); e++)
+	{
+		const PrePost &pp = op->get_pre_post()[shared_effects[e]];
+		int k = g_shared_var_timeline_index[pp.var];
+		if(k == -1)
+			continue;
+		const SharedVarTimeline &timeline = g_shared_vars_timelines[k];
+
+		// Search constraint value at that time
+		int j = (op_end_time == ctx.next_time) ? ctx.next_time_window[k] : timeline.find_window(op_end_time);
+		if(j != -1)
 		{
-			// Check that the action ending is the one that must happen first
-			const runn_action* min_action_ending = NULL;
-			float min_time = -1;
-			vector<runn_action>::const_iterator it_ra_const = curr.running_actions.begin();
-			for(; (it_ra_const != curr.running_actions.end()); it_ra_const++)
+			if((timeline.values[j] != pp.pre) && (pp.pre != -1) && (timeline.values[j] != -1))
 			{
-				if((min_time == -1) || (min_time > (*it_ra_const).time_end))
-				{
-					min_time = (*it_ra_const).time_end;
-					min_action_ending = &(*it_ra_const);
-				}
-			}
-
-			if((min_action_ending != NULL) && (min_action_ending->non_temporal_action_name != op->get_non_temporal_action_name()))
+				if(!use_hard_temporal_constraints)
+					return false;
+				if(is_temporal) {
+					if ((op->is_start_snap()) && (curr.running_actions.size() != 0))
+						return false;
+					else if (op->is_end_snap())
+						return false;
+				}else
+					return false;
+			} else if(duration.get() > ((timeline.times[j + 1]) - (curr.get_g_current_time_value())))
 			{
-				op_valid = false;
+				if(!use_hard_temporal_constraints)
+					return false;
+				if(is_temporal) {
+					if ((op->is_start_snap()) && (curr.running_actions.size() != 0))
+						return false;
+					else if (op->is_end_snap())
+						return false;
+				}
 			}
+		} else if((timeline.values.back() != pp.pre) && (pp.pre != -1) && (timeline.values.back() != -1))
+		{
+			return false;
 		}
-
-		if (!op_valid){
-			it = ops.erase(it);
-
-		}else
-			it++;
 	}
+	return true;
 }
 
-void check_temporal_goals_validity(const State &curr, vector<const Operator *> &ops){
+static bool check_temporal_goals_validity(const ValidityContext &ctx, const Operator *op) {
 	// In case the application of an action makes the state miss a temporal goal,
 	// do not propagate this search branch
-
-	vector<const Operator *>::iterator it = ops.begin();
-	for(; it != ops.end();) {
-		const Operator * op = *it;
-		bool op_valid = true;
-
-		// Obtain the end time of the action
-		/* float action_end_time = 0.0;
-		if(op->get_name().find("_end") != string::npos)
-		{
-			vector<runn_action>::const_iterator it_ra_const = curr.running_actions.begin();
-			for(; (it_ra_const != curr.running_actions.end()); it_ra_const++)
-			{
-				if((*it_ra_const).non_temporal_action_name == op->get_non_temporal_action_name())
-				{
-					action_end_time = (*it_ra_const).time_end;
-					break;
-				}
-			}
-
-		} else {
-			action_end_time = curr.get_g_current_time_value() + 0.01;
-		} */
-
-		// If the end_time has been extracted successfully,
-		// check the attained goals and delete operators that provoke invalid states
-		for (int i = 0; i < g_timed_goals.size(); i++) {
-			// Check negative timed literals
-			for (int j = 0; j < g_timed_goals[i].second.size(); j++) {
-				if (g_timed_goals[i].second[j].first.second == -1) {
-					// Check if the variable is needed by the action
-					for (int k = 0; k < op->get_pre_post().size(); k++) {
-						PrePost prepost = op->get_pre_post()[k];
-						if((prepost.pre > -1) && (prepost.var == g_timed_goals[i].second[j].first.first)) {
-							// The var needs to have a certain value by the operator
-							// Check if the application time is later than the negative timed fact
-							if(curr.get_g_current_time_value() > g_timed_goals[i].second[j].second) {
-								op_valid = false;
-								/* cout << "The action " << op->get_name() << " needs the value " <<
-										g_timed_goals[i].second[j].first.first << "," <<
-										g_timed_goals[i].second[j].first.second << " at " <<
-										g_timed_goals[i].second[j].second << "." << endl;
-								cout << "The current time is " << curr.get_g_current_time_value() <<
-										". Therefore, this search branch will not continue." << endl;
-										*/
-							}
-						}
+	const State &curr = *ctx.curr;
+	for (int i = 0; i < g_timed_goals.size(); i++) {
+		// Check negative timed literals
+		for (int j = 0; j < g_timed_goals[i].second.size(); j++) {
+			if (g_timed_goals[i].second[j].first.second == -1) {
+				// Check if the variable is needed by the action
+				for (int k = 0; k < op->get_pre_post().size(); k++) {
+					const PrePost &prepost = op->get_pre_post()[k];
+					if((prepost.pre > -1) && (prepost.var == g_timed_goals[i].second[j].first.first)) {
+						// The var needs to have a certain value by the operator
+						// Check if the application time is later than the negative timed fact
+						if(curr.get_g_current_time_value() > g_timed_goals[i].second[j].second)
+							return false;
 					}
 				}
 			}
 		}
+	}
+	return true;
+}
+
+static unsigned char evaluate_operator(const ValidityContext &ctx, const Operator *op) {
+	int op_no = op - &g_operators[0];
+	assert(op_no >= 0 && op_no < g_operators.size());
+	if(verdict_epoch[op_no] == current_verdict_epoch)
+		return verdict[op_no];
+
+	OperatorDuration duration(*ctx.curr, op, op_no, current_verdict_epoch);
+	unsigned char result = 0;
+	if(check_functional_validity(ctx, op) &&
+			(!is_temporal || (check_temporal_soundness_validity(ctx, op) &&
+					check_var_locks_validity(ctx, op, duration))) &&
+			check_external_locks_validity(ctx, op, duration))
+		result |= verdict_valid;
+	if(!is_temporal || check_temporal_goals_validity(ctx, op))
+		result |= verdict_timed_goals_valid;
+
+	verdict_epoch[op_no] = current_verdict_epoch;
+	verdict[op_no] = result;
+	return result;
+}
 
-		if (!op_valid){
-			it = ops.erase(it);
+static void compact_valid_operators(const ValidityContext &ctx, vector<const Operator *> &ops,
+		unsigned char required, bool only_start_snaps) {
+	int kept = 0;
+	for(int i = 0; i < ops.size(); i++) {
+		const Operator *op = ops[i];
+		if(only_start_snaps && !op->is_start_snap())
+			continue;
+		if((evaluate_operator(ctx, op) & required) == required)
+			ops[kept++] = op;
+	}
+	ops.resize(kept);
+}
 
-		}else
-			it++;
+void filter_valid_operators(const State &curr, vector<const Operator *> &all_ops,
+		vector<const Operator *> &preferred_ops, bool only_start_snaps) {
+	if(verdict.size() != g_operators.size()) {
+		verdict.assign(g_operators.size(), 0);
+		verdict_epoch.assign(g_operators.size(), -1);
+		current_verdict_epoch = 0;
+	}
+	if(++current_verdict_epoch == INT_MAX) {
+		verdict_epoch.assign(g_operators.size(), -1);
+		duration_epoch.assign(duration_epoch.size(), -1);
+		current_verdict_epoch = 0;
 	}
 
-	return;
+	if(duration_kind.size() != g_operators.size())
+		build_duration_table();
+
+	// Module durations are evaluated in the background while the validity context is built
+	if(g_ext_func_manager.has_workers())
+		prefetch_module_durations(curr, all_ops);
+
+	ValidityContext ctx;
+	compute_validity_context(curr, ctx);
+	compute_batch_durations(curr, all_ops, current_verdict_epoch);
+	compute_batch_durations(curr, preferred_ops, current_verdict_epoch);
+
+	// Timed goals are only enforced on the full operator list
+	compact_valid_operators(ctx, all_ops, verdict_valid | verdict_timed_goals_valid, only_start_snaps);
+	compact_valid_operators(ctx, preferred_ops, verdict_valid, only_start_snaps);
 }
 
 void SuccessorGeneratorSwitch::_dump(string indent) {
@@ -38,15 +38,9 @@ public:
 };
 
 SuccessorGenerator *read_successor_generator(std::istream &in);
-void check_functional_validity(
-		const State &curr, vector<const Operator *> &ops);
-void check_external_locks_validity(
-		const State &curr, vector<const Operator *> &ops);
-void check_var_locks_validity(
-		const State &curr, vector<const Operator *> &ops);
-void check_temporal_soundness_validity(
-		const State &curr, vector<const Operator *> &ops);
-void check_temporal_goals_validity(
-		const State &curr, vector<const Operator *> &ops);
+void filter_valid_operators(const State &curr,
+		std::vector<const Operator *> &all_ops,
+		std::vector<const Operator *> &preferred_ops,
+		bool only_start_snaps);
 
 #endif
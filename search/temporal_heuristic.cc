@@ -0,0 +1,226 @@
+/*********************************************************************
+ * This file is part of LAMA.
+ *
+ * LAMA is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the license, or (at your option) any later version.
+ *
+ * LAMA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ *********************************************************************/
+
+#include "temporal_heuristic.h"
+#include "globals.h"
+#include "operator.h"
+#include "state.h"
+
+#include <cassert>
+#include <climits>
+#include <cmath>
+
+using namespace std;
+
+TemporalHeuristic::TemporalHeuristic(const FFHeuristic &ff_heur, bool use_preferred_operators,
+				     bool use_cache)
+    : Heuristic(use_cache), ff(ff_heur), preferred_operators(use_preferred_operators) {
+    cout << "Initializing temporal relaxed plan heuristic..." << endl;
+
+    int num_propositions = ff.prop_var.size();
+    int num_unary_ops = ff.unary_operators.size();
+
+    // The effects of a start snap that are preconditions of its end snap
+    // only become true once the action has run for its duration.
+    op_delayed.assign(num_unary_ops, false);
+    for(int i = 0; i < num_unary_ops; i++) {
+	const Operator *op = ff.unary_operators[i].op;
+	if(op->is_axiom() || !op->is_start_snap() || op->get_paired_op() == -1)
+	    continue;
+	const Operator &end = g_operators[op->get_paired_op()];
+	int var = ff.prop_var[ff.op_effect[i]], val = ff.prop_val[ff.op_effect[i]];
+	for(int j = 0; j < end.get_prevail().size(); j++)
+	    if(end.get_prevail()[j].var == var && end.get_prevail()[j].prev == val)
+		op_delayed[i] = true;
+	for(int j = 0; j < end.get_pre_post().size(); j++)
+	    if(end.get_pre_post()[j].var == var && end.get_pre_post()[j].pre == val)
+		op_delayed[i] = true;
+    }
+
+    epoch = 0;
+    prop_time.assign(num_propositions, -1);
+    prop_reached_by.assign(num_propositions, -1);
+    prop_epoch.assign(num_propositions, -1);
+    prop_plan_epoch.assign(num_propositions, -1);
+    op_unsatisfied_preconditions.assign(num_unary_ops, 0);
+    op_start_time.assign(num_unary_ops, 0);
+    op_epoch.assign(num_unary_ops, -1);
+    duration_epoch.assign(g_operators.size(), -1);
+    duration_value.assign(g_operators.size(), 0);
+    release_epoch.assign(g_operators.size(), -1);
+    release_time.assign(g_operators.size(), 0);
+    for(int i = 0; i < g_operators.size(); i++)
+	if(g_operators[i].is_end_snap())
+	    end_snap_of_action[g_operators[i].get_non_temporal_action_name()] = i;
+}
+
+float TemporalHeuristic::get_duration(const State &state, int op_index) {
+    if(duration_epoch[op_index] != epoch) {
+	duration_epoch[op_index] = epoch;
+	const PrePost *dur = g_operators[op_index].get_duration_effect();
+	float duration = 0;
+	if(dur == 0)
+	    duration = 0;
+	else if(dur->have_module_cost_effect)
+	    duration = g_ext_func_manager.compute_function_at(dur->ext_func, state.numeric_vars_val);
+	else if(dur->have_runtime_cost_effect)
+	    duration = state.calculate_runtime_efect<float>(dur->runtime_effect);
+	else
+	    duration = dur->f_cost;
+	duration_value[op_index] = max(duration, 0.0f);
+    }
+    return duration_value[op_index];
+}
+
+float TemporalHeuristic::earliest_start(int op) const {
+    int op_index = ff.op_operator_index[op];
+    if(op_index == -1 || release_epoch[op_index] != epoch)
+	return 0;
+    return release_time[op_index];
+}
+
+void TemporalHeuristic::reach(int prop, float time, int op) {
+    if(prop_epoch[prop] != epoch) {
+	prop_epoch[prop] = epoch;
+	prop_time[prop] = -1;
+    }
+    if(prop_time[prop] == -1 || prop_time[prop] > time) {
+	prop_time[prop] = time;
+	prop_reached_by[prop] = op;
+	queue.push(make_pair(time, prop));
+    }
+}
+
+void TemporalHeuristic::apply_unary_operator(const State &state, int op, float start_time) {
+    float time = start_time;
+    if(op_delayed[op])
+	time += get_duration(state, ff.op_operator_index[op]);
+    reach(ff.op_effect[op], time, op);
+}
+
+void TemporalHeuristic::explore(const State &state) {
+    if(++epoch == INT_MAX) {
+	prop_epoch.assign(prop_epoch.size(), -1);
+	prop_plan_epoch.assign(prop_plan_epoch.size(), -1);
+	op_epoch.assign(op_epoch.size(), -1);
+	duration_epoch.assign(duration_epoch.size(), -1);
+	release_epoch.assign(release_epoch.size(), -1);
+	epoch = 0;
+    }
+    while(!queue.empty())
+	queue.pop();
+
+    for(int i = 0; i < state.running_actions.size(); i++) {
+	const runn_action &action = state.running_actions[i];
+	unordered_map<string, int>::const_iterator it =
+	    end_snap_of_action.find(action.non_temporal_action_name);
+	if(it == end_snap_of_action.end())
+	    continue;
+	release_epoch[it->second] = epoch;
+	release_time[it->second] = max(action.time_end - state.get_g_current_time_value(), 0.0f);
+    }
+
+    for(int var = 0; var < g_variable_domain.size(); var++)
+	if(state[var] != -1)
+	    reach(ff.get_prop_id(var, state[var]), 0, -1);
+    for(int i = 0; i < ff.precondition_free_operators.size(); i++) {
+	int op = ff.precondition_free_operators[i];
+	op_epoch[op] = epoch;
+	op_start_time[op] = earliest_start(op);
+	apply_unary_operator(state, op, op_start_time[op]);
+    }
+
+    // Dijkstra on earliest achievement times. Unary operators pruned by the
+    // FF heuristic are used too: the durations of their operators differ.
+    while(!queue.empty()) {
+	QueueEntry entry = queue.top();
+	queue.pop();
+	int prop = entry.second;
+	if(entry.first > prop_time[prop])
+	    continue;
+	for(int i = ff.prop_all_trigger_begin[prop]; i < ff.prop_all_trigger_begin[prop + 1]; i++) {
+	    int op = ff.prop_all_triggers[i];
+	    if(op_epoch[op] != epoch) {
+		op_epoch[op] = epoch;
+		op_unsatisfied_preconditions[op] = ff.op_pre_begin[op + 1] - ff.op_pre_begin[op];
+		op_start_time[op] = earliest_start(op);
+	    }
+	    op_unsatisfied_preconditions[op]--;
+	    op_start_time[op] = max(op_start_time[op], entry.first);
+	    if(op_unsatisfied_preconditions[op] == 0)
+		apply_unary_operator(state, op, op_start_time[op]);
+	}
+    }
+}
+
+bool TemporalHeuristic::is_helpful(int op) const {
+    if(ff.op_is_axiom[op])
+	return false;
+    for(int i = ff.op_pre_begin[op]; i < ff.op_pre_begin[op + 1]; i++)
+	if(prop_reached_by[ff.op_pre[i]] != -1)
+	    return false;
+    return true;
+}
+
+void TemporalHeuristic::collect_relaxed_plan(int goal, const State &state) {
+    extraction_stack.clear();
+    extraction_stack.push_back(goal);
+    while(!extraction_stack.empty()) {
+	int prop = extraction_stack.back();
+	extraction_stack.pop_back();
+	if(prop_plan_epoch[prop] == epoch)
+	    continue;
+	prop_plan_epoch[prop] = epoch;
+	int op = prop_reached_by[prop];
+	if(op == -1)
+	    continue;
+	const Operator *the_op = ff.unary_operators[op].op;
+	if(is_helpful(op) && the_op->is_applicable(state))
+	    set_preferred(the_op);
+	for(int i = ff.op_pre_begin[op]; i < ff.op_pre_begin[op + 1]; i++)
+	    extraction_stack.push_back(ff.op_pre[i]);
+    }
+}
+
+unsigned long long TemporalHeuristic::cache_key(const State &state) const {
+    return state.get_temporal_hash();
+}
+
+int TemporalHeuristic::compute_heuristic(const State &state) {
+    bool goal_reached = true;
+    for(int i = 0; i < g_goal.size(); i++)
+	if(state[g_goal[i].first] != g_goal[i].second)
+	    goal_reached = false;
+    if(goal_reached)
+	return 0;
+
+    explore(state);
+    float makespan = 0;
+    for(int i = 0; i < ff.goal_propositions.size(); i++) {
+	int goal = ff.goal_propositions[i];
+	if(prop_epoch[goal] != epoch || prop_time[goal] == -1)
+	    return DEAD_END;
+	makespan = max(makespan, prop_time[goal]);
+    }
+
+    if(preferred_operators)
+	for(int i = 0; i < ff.goal_propositions.size(); i++)
+	    collect_relaxed_plan(ff.goal_propositions[i], state);
+
+    return max(1, int(ceil(makespan)));
+}
@@ -0,0 +1,87 @@
+/*********************************************************************
+ * This file is part of LAMA.
+ *
+ * LAMA is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the license, or (at your option) any later version.
+ *
+ * LAMA is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ *********************************************************************/
+
+#ifndef TEMPORAL_HEURISTIC_H
+#define TEMPORAL_HEURISTIC_H
+
+#include "heuristic.h"
+#include "ff_heuristic.h"
+
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unordered_map>
+
+/* Temporal relaxed plan heuristic: estimates the remaining makespan.
+
+   Earliest achievement times are propagated through the unary operators
+   of the FF heuristic (whose compiled data is shared): an operator can
+   start when its last precondition is reached, and the effects of a start
+   snap that enable its end snap are delayed by the duration of the
+   action, evaluated in the state as in the successor generator. The
+   heuristic value is the earliest time at which all goals hold, rounded
+   up and at least 1 in non-goal states; operators of the relaxed plan
+   applicable in the state are preferred. Numeric conditions are ignored.
+
+   The facts a running action's start snap set for its end snap already
+   hold in the state, so the end snap of a running action cannot start
+   before the action's remaining duration has elapsed. */
+class TemporalHeuristic : public Heuristic {
+    const FFHeuristic &ff;
+    bool preferred_operators;
+
+    std::vector<char> op_delayed; // effect enables the end snap of a start snap
+
+    int epoch;
+    std::vector<float> prop_time;       // -1 if not reached
+    std::vector<int> prop_reached_by;   // unary operator, -1 for the state
+    std::vector<int> prop_epoch;
+    std::vector<int> prop_plan_epoch;
+    std::vector<int> op_unsatisfied_preconditions;
+    std::vector<float> op_start_time;
+    std::vector<int> op_epoch;
+    std::vector<int> duration_epoch;    // per operator of g_operators
+    std::vector<float> duration_value;
+    std::vector<int> release_epoch;     // per operator of g_operators
+    std::vector<float> release_time;    // earliest start of end snaps of running actions
+    std::unordered_map<std::string, int> end_snap_of_action; // by non-temporal name
+    float earliest_start(int op) const;
+
+    typedef std::pair<float, int> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+			std::greater<QueueEntry> > queue;
+    std::vector<int> extraction_stack;
+
+    float get_duration(const State &state, int op_index);
+    void reach(int prop, float time, int op);
+    void apply_unary_operator(const State &state, int op, float start_time);
+    void explore(const State &state);
+    bool is_helpful(int op) const;
+    void collect_relaxed_plan(int goal, const State &state);
+protected:
+    virtual int compute_heuristic(const State &state);
+    // The release times depend on the running actions and the current time
+    virtual unsigned long long cache_key(const State &state) const;
+public:
+    TemporalHeuristic(const FFHeuristic &ff_heur, bool use_preferred_operators,
+		      bool use_cache=false);
+    ~TemporalHeuristic() {}
+};
+
+#endif
@@ -111,12 +111,6 @@ int WAStarSearchEngine::step() {
 void WAStarSearchEngine::generate_successors(const State *parent_ptr) {
     vector<const Operator *> all_operators;
     g_successor_generator->generate_applicable_ops(current_state, all_operators);
-    check_functional_validity(current_state, all_operators);
-    if(is_temporal){
-		check_var_locks_validity(current_state, all_operators);
-		check_temporal_soundness_validity(current_state, all_operators);
-    }
-    check_external_locks_validity(current_state, all_operators);
 
     vector<const Operator *> preferred_operators;
     for(int i = 0; i < preferred_operator_heuristics.size(); i++) {
@@ -124,20 +118,14 @@ void WAStarSearchEngine::generate_successors(const State *parent_ptr) {
 	if(!heur->is_dead_end())
 	    heur->get_preferred_operators(preferred_operators);
     }
-    check_functional_validity(current_state, preferred_operators);
-    if(is_temporal){
-		check_var_locks_validity(current_state, preferred_operators);
-		check_temporal_soundness_validity(current_state, preferred_operators);
-		check_temporal_goals_validity(current_state, all_operators);
-    }
-    check_external_locks_validity(current_state, preferred_operators);
+    filter_valid_operators(current_state, all_operators, preferred_operators, false);
 
     /*if(parent_ptr->running_actions.size() > 4)
     {
     	vector<const Operator *>::iterator it = all_operators.begin();
     	for(; it != all_operators.end();) {
 
-    		if((*it)->get_name().find("_start") == string::npos) {
+    		if(!(*it)->is_start_snap()) {
     			it = all_operators.erase(it);
     		}else
     			it++;
@@ -146,7 +134,7 @@ void WAStarSearchEngine::generate_successors(const State *parent_ptr) {
     	it = preferred_operators.begin();
 		for(; it != preferred_operators.end();) {
 
-			if((*it)->get_name().find("_start") == string::npos) {
+			if(!(*it)->is_start_snap()) {
 				it = preferred_operators.erase(it);
 			}else
 				it++;